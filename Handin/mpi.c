@@ -1,158 +1,5310 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <math.h>
+#include <complex.h>
+#include <float.h>
 #include <time.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <mpi.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+/**
+ * @brief The inner loop used to relax each row of the plane. Every kernel
+ *         apart from KERNEL_GS uses red-black ordering
+ */
+typedef enum {
+    KERNEL_GS,
+    KERNEL_RB,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    KERNEL_SIMD
+} Kernel;
+
+/**
+ * @brief Largest change made by a thread in one iteration, padded out to a
+ *         cache line so no two threads ever write to the same line
+ */
+typedef struct {
+    double maxDelta;
+    char padding[64 - sizeof(double)];
+} ThreadDelta;
+
+/**
+ * @brief Relaxes part of a single row, returning the largest absolute change
+ *         made to any cell
+ */
+typedef double (*RowKernel)(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega);
+
+/**
+ * @brief Relaxes part of a single row without finding the changes made, for
+ *         the sweeps between convergence checks
+ */
+typedef void (*UncheckedRowKernel)(const double* restrict above,
+    double* restrict row, const double* restrict below, int start, int end,
+    double omega);
+
+/**
+ * @brief Relaxes part of a single row stored as floats, returning the largest
+ *         absolute change made to any cell
+ */
+typedef float (*FloatRowKernel)(const float* restrict above,
+    float* restrict row, const float* restrict below, int start, int end,
+    float omega);
+
+/**
+ * @brief Calculates the next Jacobi iterate of part of a row, returning the
+ *         largest absolute change made to any cell
+ */
+typedef double (*JacobiRowKernel)(const double* restrict above,
+    const double* restrict row, const double* restrict below,
+    double* restrict out, int start, int end, bool stream);
+
+/**
+ * @brief The algorithm used to solve the plane
+ */
+typedef enum {
+    METHOD_RELAX,
+    METHOD_JACOBI,
+    METHOD_SOR,
+    METHOD_MG,
+    METHOD_CG,
+    METHOD_PIPECG,
+    METHOD_CHEBYSHEV,
+    METHOD_DST
+} Method;
+
+/**
+ * @brief How edge rows are swapped between processes while relaxing
+ */
+typedef enum {
+    HALO_P2P,
+    HALO_RMA,
+    HALO_SHARED,
+    HALO_GRAPH
+} HaloMode;
+
+/**
+ * @brief Everything needed to swap the edge rows of one array with the
+ *         processes above and below this one, in any HaloMode
+ */
+typedef struct {
+    HaloMode mode;
+    double** plane;
+    int numRows;
+    int sizeOfPlane;
+    int world_rank;
+    int world_size;
+    bool pending;
+    MPI_Request requests[4];
+    int numRequests;
+    MPI_Win window;
+    MPI_Group neighbours;
+    MPI_Aint aboveLastRow;
+    MPI_Comm node;
+    double* rows;
+    int stride;
+    bool sharedAbove;
+    bool sharedBelow;
+    MPI_Comm graph;
+    int counts[2];
+    int sendDispls[2];
+    int recvDispls[2];
+} HaloExchange;
+
+/**
+ * @brief Where each process's rows start while they are shared out by how
+ *         quickly each process relaxes them, and how long this process has
+ *         spent relaxing since they were last shared out. The array, its
+ *         number of rows and its first row are replaced when rows move
+ */
+typedef struct {
+    double*** plane;
+    int* numRows;
+    int* firstRow;
+    int interval;
+    int sinceBalance;
+    double seconds;
+    int* bounds;
+} Balance;
+
+/**
+ * @brief Everything needed to reduce in two levels: over the processes on
+ *         each node through memory they share, then over one process from
+ *         each node. The shared array holds the result, then the values from
+ *         each process on the node in turn
+ */
+typedef struct {
+    MPI_Comm node;
+    MPI_Comm leaders;
+    MPI_Win window;
+    double* slots;
+    int nodeRank;
+    int nodeSize;
+    int count;
+} NodeReduction;
+
+/**
+ * @brief How the over-relaxation factor of the sor method is chosen
+ */
+typedef enum {
+    OMEGA_FIXED,
+    OMEGA_GRID,
+    OMEGA_ESTIMATE
+} OmegaMode;
+
+/**
+ * @brief The over-relaxation factor in use, and what is needed to estimate a
+ *         better one from how quickly the plane is converging
+ */
+typedef struct {
+    double omega;
+    // Whether omega may be other than 1, which needs the over-relaxed kernels
+    bool over;
+    bool estimating;
+    // Optimum for the 5-point Laplacian, which the estimate may not pass
+    double limit;
+    double lastDelta;
+    double lastRatio;
+    unsigned long samples;
+} OmegaEstimate;
+
+// Iterations to wait after changing omega before measuring the decay again
+#define OMEGA_MIN_SAMPLES 10
+// Relative change below which the decay or omega is considered settled
+#define OMEGA_SETTLED 0.01
+
+/**
+ * @brief How many iterations to do before the next convergence check. With
+ *         -c adaptive this follows how quickly the plane is converging
+ */
+typedef struct {
+    int interval;
+    bool adaptive;
+    double lastDelta;
+} CheckSchedule;
+
+// Value of -c that picks the number of iterations between checks as it runs
+#define CHECK_ADAPTIVE -1
+// Most iterations done between adaptive checks, which bounds how many extra
+// iterations can be done after converging
+#define CHECK_MAX 64
+
+/**
+ * @brief Every process, ordered so that processes next to each other in it
+ *         hold rows next to each other in the plane. Set up by newPlaneComm
+ *         straight after MPI starts, and used in place of MPI_COMM_WORLD
+ */
+MPI_Comm planeComm;
+
+// Changes per sweep within this many float epsilons of the largest cell are
+// rounding noise, so the float sweeps have gone as far as they can
+#define MIXED_STALL 16
+// Over-relaxation amplifies the rounding noise, so the float sweeps have also
+// stalled once this many go by without a new smallest change
+#define MIXED_PATIENCE 64
+
+/**
+ * @brief One grid of the multigrid hierarchy. Level 0 is the plane itself,
+ *         and each level after it keeps every other row and column. A level
+ *         is either split into rows like the plane, or held whole by process 0
+ */
+typedef struct {
+    int n;
+    int numRows;
+    int firstRow;
+    bool distributed;
+    double** u;
+    double** rhs;
+    double** res;
+} MultigridLevel;
+
+/**
+ * @brief The multigrid hierarchy of this process. Levels before agglomerate
+ *         are split between the processes. From agglomerate on the levels are
+ *         held whole by process 0, and slab holds this process's rows of the
+ *         first of them so they can be gathered and scattered
+ */
+typedef struct {
+    MultigridLevel* levels;
+    MultigridLevel slab;
+    int numLevels;
+    int agglomerate;
+    double* top;
+    double* bottom;
+    double* left;
+    double* right;
+    int* slabFirst;
+    int* slabRows;
+    int* counts;
+    int* displs;
+    RowKernel relaxRow;
+    int world_rank;
+    int world_size;
+} Multigrid;
+
+// Smoothing sweeps done before and after visiting the coarser level
+#define MG_SMOOTH 2
+// Sweeps used to solve the coarsest level, which is at most 4x4
+#define MG_COARSE_SWEEPS 20
+// Fewest rows of a level each process must own to keep the level split
+#define MG_MIN_ROWS 4
+
+/**
+ * @brief Everything needed to find the discrete sine transform of rows of a
+ *         given length. The transform is found from an FFT of the row's odd
+ *         extension, which can be any even length, so that FFT is done as a
+ *         convolution with a chirp using power of two FFTs (Bluestein)
+ */
+typedef struct {
+    int length;
+    int size;
+    double complex* chirp;
+    double complex* kernel;
+    double complex* twiddle;
+    double complex* work;
+} DstPlan;
+
+/**
+ * @brief This process's block of the plane when the plane is split into a 2D
+ *         grid of blocks, one per process, and the processes next to it.
+ *         Each block holds a row or column of edge cells on every side
+ */
+typedef struct {
+    MPI_Comm comm;
+    int dims[2];
+    int rank;
+    int up;
+    int down;
+    int left;
+    int right;
+    int numRows;
+    int numCols;
+    int firstRow;
+    int firstCol;
+} CartBlock;
 
 int asprintf(char **strp, const char *fmt, ...);
 
 
 /**
- * @brief Calculates the time in seconds between two timespec structs
- * @param start timespec struct with time less than end
- * @param end timespec struct with time greater than start
- * @return time difference between two struct
+ * @brief Calculates the time in seconds between two timespec structs
+ * @param start timespec struct with time less than end
+ * @param end timespec struct with time greater than start
+ * @return time difference between two struct
+ */
+long double toSeconds(struct timespec start, struct timespec end) {
+    long long difSec = end.tv_sec - start.tv_sec;
+    long long difNSec = end.tv_nsec - start.tv_nsec;
+    long long totalNS = difSec*1000000000L + difNSec;
+    return (long double) totalNS / 1000000000.0;
+}
+
+/**
+ * @brief Mallocs memory for a n*rows 2D array. Memory for array is contiguous,
+           for when I was using MPI_Gatherv. Each row is padded out to start
+           on a cache line
+ * @param n the size of each row in the 2D array
+ * @param rows the number of rows in the 2D array
+ * @return a pointer to an array of pointers to each row in the 2D array
+ */
+double** newSubPlane(unsigned int n, unsigned int rows) {
+    unsigned int stride = (n + 7) & ~7u;
+    double** plane  = ( double** )malloc(rows * sizeof(double*));
+    plane[0] = ( double * )aligned_alloc(64, (size_t)rows * stride
+        * sizeof(double));
+
+    for(unsigned int i = 0; i<rows; i++)
+        plane[i] = (*plane + (size_t)stride * i);
+
+    return plane;
+}
+
+/**
+ * @brief Frees a 2D array made by newSubPlane
+ */
+void freePlane(double** plane) {
+    free(plane[0]);
+    free(plane);
+}
+
+/**
+ * @brief Mallocs memory for a n*rows 2D array of floats, laid out like
+ *         newSubPlane
+ * @param n the size of each row in the 2D array
+ * @param rows the number of rows in the 2D array
+ * @return a pointer to an array of pointers to each row in the 2D array
+ */
+float** newFloatSubPlane(unsigned int n, unsigned int rows) {
+    unsigned int stride = (n + 15) & ~15u;
+    float** plane  = ( float** )malloc(rows * sizeof(float*));
+    plane[0] = ( float* )aligned_alloc(64, (size_t)rows * stride
+        * sizeof(float));
+
+    for(unsigned int i = 0; i<rows; i++)
+        plane[i] = (*plane + (size_t)stride * i);
+
+    return plane;
+}
+
+/**
+ * @brief Populates the plane's walls with the values provided, and sets the
+ *         centre parts to zero
+ * @param plane pointer to the 2D array
+  * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param top value to put in top edge of 2D array
+ * @param bottom value to put in bottom edge of 2D array
+ * @param farLeft value to put in left edge of 2D array
+ * @param farRight value to put in right edge of 2D array
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ */
+void populateSubPlane(double** plane, int sizeOfPlane, int numRows, double top,
+    double bottom, double farLeft, double farRight, int world_rank,
+    int world_size)
+{   
+    for(int i=0; i<numRows; i++) {
+        for(int j=0; j<sizeOfPlane; j++) {
+            if(j == 0) {
+                // Left
+                plane[i][j] = farLeft;
+            } else if(i == 0 && world_rank == 0) {
+                // Top
+                plane[i][j] = top;
+            } else if(j == sizeOfPlane-1) {
+                // Right
+                plane[i][j] = farRight;
+            } else if(i == numRows-1 && world_rank == world_size-1) {
+                // Bottom
+                plane[i][j] = bottom;
+            } else {
+                plane[i][j] = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Relaxes every cell of a row from left to right (Gauss-Seidel)
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param omega unused, as plain relaxation has an omega of 1
+ * @return the largest absolute change made to any cell
+ */
+double relaxRowGS(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    double pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Relaxes every other cell of a row, i.e. the cells of one colour for
+ *         red-black ordering
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column of this colour to relax
+ * @param end column after the last one to relax
+ * @param omega unused, as plain relaxation has an omega of 1
+ * @return the largest absolute change made to any cell
+ */
+double relaxRowRB(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    double pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The SIMD kernels below never reload a cell from the row once part of it has
+ *  been stored, as an unaligned load overlapping an earlier store stalls.
+ *  Instead the neighbours to the left and right are shifted out of the
+ *  vectors already in registers. This is safe as those neighbours are always
+ *  the other colour, so are never changed during the sweep. Only the cells
+ *  of this colour are stored, so threads relaxing neighbouring rows never
+ *  write to the cells each other are reading.
+ */
+
+/**
+ * @brief SSE2 version of relaxRowRB. Pairs of cells of this colour are split
+ *         out from the cells of the other colour, relaxed, then stored back
+ *         one cell at a time
+ */
+__attribute__((target("sse2")))
+double relaxRowSSE2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    __m128d maxDelta = _mm_setzero_pd();
+    __m128d lo, hi, old, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    double lanes[2];
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        old = _mm_unpacklo_pd(lo, hi);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        maxDelta = _mm_max_pd(maxDelta,
+            _mm_andnot_pd(signMask, _mm_sub_pd(val, old)));
+        prevEast = east;
+    }
+
+    _mm_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    if(j < end) {
+        lanes[1] = relaxRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of relaxRowRB. Every lane is calculated and the cells
+ *         of the other colour are blended back to their old values, with
+ *         only the lanes of this colour being stored
+ */
+__attribute__((target("avx2")))
+double relaxRowAVX2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    __m256d maxDelta = _mm256_setzero_pd();
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    double lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm256_blend_pd(cur, _mm256_mul_pd(val, quarter), 0x5);
+        _mm256_maskstore_pd(&row[j], storeMask, val);
+        maxDelta = _mm256_max_pd(maxDelta,
+            _mm256_andnot_pd(signMask, _mm256_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = relaxRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX-512 version of relaxRowRB. Every lane is calculated and the
+ *         cells of the other colour are masked back to their old values,
+ *         with only the lanes of this colour being stored
+ */
+__attribute__((target("avx512f")))
+double relaxRowAVX512(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d maxDelta = _mm512_setzero_pd();
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    double result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_mask_blend_pd(0x55, cur, _mm512_mul_pd(val, quarter));
+        _mm512_mask_storeu_pd(&row[j], 0x55, val);
+        maxDelta = _mm512_max_pd(maxDelta,
+            _mm512_abs_pd(_mm512_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_pd(maxDelta);
+    if(j < end) {
+        tail = relaxRowRB(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+
+/**
+ * @brief Float version of relaxRowGS
+ */
+float relaxRowGSFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    float pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Float version of relaxRowRB
+ */
+float relaxRowRBFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    float pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The float kernels work the same way as the double kernels above, with twice
+ *  as many cells in each vector. They are only used by one thread per plane.
+ */
+
+/**
+ * @brief SSE2 version of relaxRowRBFloat. SSE2 has no masked store, so the
+ *         cells of the other colour are stored back with their old values
+ */
+__attribute__((target("sse2")))
+float relaxRowSSE2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 colourMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+    __m128 maxDelta = _mm_setzero_ps();
+    __m128 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128 prev = _mm_set1_ps(row[start-1]);
+    float lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm_loadu_ps(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm_loadu_ps(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        tmp = _mm_shuffle_ps(prev, cur, _MM_SHUFFLE(0, 0, 3, 3));
+        west = _mm_shuffle_ps(tmp, cur, _MM_SHUFFLE(2, 1, 2, 0));
+        tmp = _mm_shuffle_ps(cur, next, _MM_SHUFFLE(0, 0, 3, 3));
+        east = _mm_shuffle_ps(cur, tmp, _MM_SHUFFLE(2, 0, 2, 1));
+        val = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(&above[j]),
+            _mm_loadu_ps(&below[j])), west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm_mul_ps(val, quarter);
+        val = _mm_or_ps(_mm_and_ps(colourMask, val),
+            _mm_andnot_ps(colourMask, cur));
+        _mm_storeu_ps(&row[j], val);
+        maxDelta = _mm_max_ps(maxDelta,
+            _mm_andnot_ps(signMask, _mm_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm_storeu_ps(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = relaxRowRBFloat(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of relaxRowRBFloat
+ */
+__attribute__((target("avx2")))
+float relaxRowAVX2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256i storeMask = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    __m256 maxDelta = _mm256_setzero_ps();
+    __m256 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256 prev = _mm256_set1_ps(row[start-1]);
+    float lanes[8], result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm256_loadu_ps(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm256_loadu_ps(&row[j+8]);
+        // Shift by one cell across the halves of the vectors
+        tmp = _mm256_permute2f128_ps(prev, cur, 0x21);
+        west = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(cur), _mm256_castps_si256(tmp), 12));
+        tmp = _mm256_permute2f128_ps(cur, next, 0x21);
+        east = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(tmp), _mm256_castps_si256(cur), 4));
+        val = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_loadu_ps(&above[j]), _mm256_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm256_blend_ps(cur, _mm256_mul_ps(val, quarter), 0x55);
+        _mm256_maskstore_ps(&row[j], storeMask, val);
+        maxDelta = _mm256_max_ps(maxDelta,
+            _mm256_andnot_ps(signMask, _mm256_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_ps(lanes, maxDelta);
+    result = lanes[0];
+    for(int k=1; k<8; k++)
+        result = lanes[k] > result ? lanes[k] : result;
+    if(j < end) {
+        tail = relaxRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+
+/**
+ * @brief AVX-512 version of relaxRowRBFloat
+ */
+__attribute__((target("avx512f")))
+float relaxRowAVX512Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m512 quarter = _mm512_set1_ps(0.25f);
+    const __m512i westIdx = _mm512_set_epi32(30, 29, 28, 27, 26, 25, 24, 23,
+        22, 21, 20, 19, 18, 17, 16, 15);
+    const __m512i eastIdx = _mm512_set_epi32(16, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1);
+    __m512 maxDelta = _mm512_setzero_ps();
+    __m512 cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512 prev = _mm512_set1_ps(row[start-1]);
+    float result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+31
+    if(j+31 < end)
+        cur = _mm512_loadu_ps(&row[j]);
+    for(; j+31<end; j+=16) {
+        next = _mm512_loadu_ps(&row[j+16]);
+        west = _mm512_permutex2var_ps(prev, westIdx, cur);
+        east = _mm512_permutex2var_ps(cur, eastIdx, next);
+        val = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(
+            _mm512_loadu_ps(&above[j]), _mm512_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_mask_blend_ps(0x5555, cur, _mm512_mul_ps(val, quarter));
+        _mm512_mask_storeu_ps(&row[j], 0x5555, val);
+        maxDelta = _mm512_max_ps(maxDelta,
+            _mm512_abs_ps(_mm512_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_ps(maxDelta);
+    if(j < end) {
+        tail = relaxRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+
+/*
+ * The over-relaxed kernels are kept apart from the plain ones, which they
+ *  would otherwise slow down. They are built without fused multiply-adds,
+ *  which would round the blend differently in the kernels that can use them.
+ */
+
+/**
+ * @brief Over-relaxes every cell of a row from left to right, moving each
+ *         cell omega times as far as relaxRowGS would (SOR)
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param omega over-relaxation factor
+ * @return the largest absolute change made to any cell
+ */
+__attribute__((optimize("fp-contract=off")))
+double sorRowGS(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+    double pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Over-relaxes every other cell of a row, moving each cell omega
+ *         times as far as relaxRowRB would
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column of this colour to relax
+ * @param end column after the last one to relax
+ * @param omega over-relaxation factor
+ * @return the largest absolute change made to any cell
+ */
+__attribute__((optimize("fp-contract=off")))
+double sorRowRB(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+    double pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/**
+ * @brief SSE2 version of sorRowRB. Pairs of cells of this colour are split
+ *         out from the cells of the other colour, relaxed, then stored back
+ *         one cell at a time
+ */
+__attribute__((target("sse2"), optimize("fp-contract=off")))
+double sorRowSSE2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    const __m128d vOmega = _mm_set1_pd(omega);
+    const __m128d vRest = _mm_set1_pd(1 - omega);
+    __m128d maxDelta = _mm_setzero_pd();
+    __m128d lo, hi, old, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    double lanes[2];
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        old = _mm_unpacklo_pd(lo, hi);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        val = _mm_add_pd(_mm_mul_pd(vOmega, val), _mm_mul_pd(vRest, old));
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        maxDelta = _mm_max_pd(maxDelta,
+            _mm_andnot_pd(signMask, _mm_sub_pd(val, old)));
+        prevEast = east;
+    }
+
+    _mm_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    if(j < end) {
+        lanes[1] = sorRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of sorRowRB. Every lane is calculated and the cells
+ *         of the other colour are blended back to their old values, with
+ *         only the lanes of this colour being stored
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+double sorRowAVX2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    const __m256d vOmega = _mm256_set1_pd(omega);
+    const __m256d vRest = _mm256_set1_pd(1 - omega);
+    __m256d maxDelta = _mm256_setzero_pd();
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    double lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm256_add_pd(_mm256_mul_pd(vOmega, _mm256_mul_pd(val, quarter)),
+            _mm256_mul_pd(vRest, cur));
+        val = _mm256_blend_pd(cur, val, 0x5);
+        _mm256_maskstore_pd(&row[j], storeMask, val);
+        maxDelta = _mm256_max_pd(maxDelta,
+            _mm256_andnot_pd(signMask, _mm256_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = sorRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX-512 version of sorRowRB. Every lane is calculated and the
+ *         cells of the other colour are masked back to their old values,
+ *         with only the lanes of this colour being stored
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+double sorRowAVX512(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512d vOmega = _mm512_set1_pd(omega);
+    const __m512d vRest = _mm512_set1_pd(1 - omega);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d maxDelta = _mm512_setzero_pd();
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    double result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_add_pd(_mm512_mul_pd(vOmega, _mm512_mul_pd(val, quarter)),
+            _mm512_mul_pd(vRest, cur));
+        val = _mm512_mask_blend_pd(0x55, cur, val);
+        _mm512_mask_storeu_pd(&row[j], 0x55, val);
+        maxDelta = _mm512_max_pd(maxDelta,
+            _mm512_abs_pd(_mm512_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_pd(maxDelta);
+    if(j < end) {
+        tail = sorRowRB(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+/*
+ * The unchecked kernels below are for the sweeps between convergence checks.
+ *  They make the same changes as the kernels above, but do not find how large
+ *  those changes are, which leaves each loop as just the stencil and stores.
+ */
+
+/**
+ * @brief Version of relaxRowGS that does not find the change made
+ */
+void relaxRowGSUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    (void)omega;
+    for(int j=start; j<end; j++)
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+}
+
+/**
+ * @brief Version of relaxRowRB that does not find the change made
+ */
+void relaxRowRBUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    (void)omega;
+    for(int j=start; j<end; j+=2)
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+}
+
+/**
+ * @brief Version of sorRowGS that does not find the change made
+ */
+__attribute__((optimize("fp-contract=off")))
+void sorRowGSUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+
+    for(int j=start; j<end; j++)
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*row[j];
+}
+
+/**
+ * @brief Version of sorRowRB that does not find the change made
+ */
+__attribute__((optimize("fp-contract=off")))
+void sorRowRBUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+
+    for(int j=start; j<end; j+=2)
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*row[j];
+}
+
+#ifdef HAVE_X86_SIMD
+/**
+ * @brief Version of relaxRowSSE2 that does not find the change made
+ */
+__attribute__((target("sse2")))
+void relaxRowSSE2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    __m128d lo, hi, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        prevEast = east;
+    }
+
+    if(j < end)
+        relaxRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of relaxRowAVX2 that does not find the change made. Only
+ *         the lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx2")))
+void relaxRowAVX2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        _mm256_maskstore_pd(&row[j], storeMask, _mm256_mul_pd(val, quarter));
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        relaxRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of relaxRowAVX512 that does not find the change made. Only
+ *         the lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx512f")))
+void relaxRowAVX512Unchecked(const double* restrict above,
+    double* restrict row, const double* restrict below, int start, int end,
+    double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        _mm512_mask_storeu_pd(&row[j], 0x55, _mm512_mul_pd(val, quarter));
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        relaxRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of sorRowSSE2 that does not find the change made
+ */
+__attribute__((target("sse2"), optimize("fp-contract=off")))
+void sorRowSSE2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d vOmega = _mm_set1_pd(omega);
+    const __m128d vRest = _mm_set1_pd(1 - omega);
+    __m128d lo, hi, old, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        old = _mm_unpacklo_pd(lo, hi);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        val = _mm_add_pd(_mm_mul_pd(vOmega, val), _mm_mul_pd(vRest, old));
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        prevEast = east;
+    }
+
+    if(j < end)
+        sorRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of sorRowAVX2 that does not find the change made. Only the
+ *         lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+void sorRowAVX2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    const __m256d vOmega = _mm256_set1_pd(omega);
+    const __m256d vRest = _mm256_set1_pd(1 - omega);
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        val = _mm256_add_pd(_mm256_mul_pd(vOmega, _mm256_mul_pd(val, quarter)),
+            _mm256_mul_pd(vRest, cur));
+        _mm256_maskstore_pd(&row[j], storeMask, val);
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        sorRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of sorRowAVX512 that does not find the change made. Only
+ *         the lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+void sorRowAVX512Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512d vOmega = _mm512_set1_pd(omega);
+    const __m512d vRest = _mm512_set1_pd(1 - omega);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        val = _mm512_add_pd(_mm512_mul_pd(vOmega, _mm512_mul_pd(val, quarter)),
+            _mm512_mul_pd(vRest, cur));
+        _mm512_mask_storeu_pd(&row[j], 0x55, val);
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        sorRowRBUnchecked(above, row, below, j, end, omega);
+}
+#endif
+
+/**
+ * @brief Float version of sorRowGS
+ */
+__attribute__((optimize("fp-contract=off")))
+float sorRowGSFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const float rest = 1 - omega;
+    float pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Float version of sorRowRB
+ */
+__attribute__((optimize("fp-contract=off")))
+float sorRowRBFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const float rest = 1 - omega;
+    float pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/**
+ * @brief SSE2 version of sorRowRBFloat. SSE2 has no masked store, so the
+ *         cells of the other colour are stored back with their old values
+ */
+__attribute__((target("sse2"), optimize("fp-contract=off")))
+float sorRowSSE2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 colourMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+    const __m128 vOmega = _mm_set1_ps(omega);
+    const __m128 vRest = _mm_set1_ps(1 - omega);
+    __m128 maxDelta = _mm_setzero_ps();
+    __m128 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128 prev = _mm_set1_ps(row[start-1]);
+    float lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm_loadu_ps(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm_loadu_ps(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        tmp = _mm_shuffle_ps(prev, cur, _MM_SHUFFLE(0, 0, 3, 3));
+        west = _mm_shuffle_ps(tmp, cur, _MM_SHUFFLE(2, 1, 2, 0));
+        tmp = _mm_shuffle_ps(cur, next, _MM_SHUFFLE(0, 0, 3, 3));
+        east = _mm_shuffle_ps(cur, tmp, _MM_SHUFFLE(2, 0, 2, 1));
+        val = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(&above[j]),
+            _mm_loadu_ps(&below[j])), west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm_add_ps(_mm_mul_ps(vOmega, _mm_mul_ps(val, quarter)),
+            _mm_mul_ps(vRest, cur));
+        val = _mm_or_ps(_mm_and_ps(colourMask, val),
+            _mm_andnot_ps(colourMask, cur));
+        _mm_storeu_ps(&row[j], val);
+        maxDelta = _mm_max_ps(maxDelta,
+            _mm_andnot_ps(signMask, _mm_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm_storeu_ps(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = sorRowRBFloat(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of sorRowRBFloat
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+float sorRowAVX2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256i storeMask = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    const __m256 vOmega = _mm256_set1_ps(omega);
+    const __m256 vRest = _mm256_set1_ps(1 - omega);
+    __m256 maxDelta = _mm256_setzero_ps();
+    __m256 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256 prev = _mm256_set1_ps(row[start-1]);
+    float lanes[8], result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm256_loadu_ps(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm256_loadu_ps(&row[j+8]);
+        // Shift by one cell across the halves of the vectors
+        tmp = _mm256_permute2f128_ps(prev, cur, 0x21);
+        west = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(cur), _mm256_castps_si256(tmp), 12));
+        tmp = _mm256_permute2f128_ps(cur, next, 0x21);
+        east = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(tmp), _mm256_castps_si256(cur), 4));
+        val = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_loadu_ps(&above[j]), _mm256_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm256_add_ps(_mm256_mul_ps(vOmega, _mm256_mul_ps(val, quarter)),
+            _mm256_mul_ps(vRest, cur));
+        val = _mm256_blend_ps(cur, val, 0x55);
+        _mm256_maskstore_ps(&row[j], storeMask, val);
+        maxDelta = _mm256_max_ps(maxDelta,
+            _mm256_andnot_ps(signMask, _mm256_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_ps(lanes, maxDelta);
+    result = lanes[0];
+    for(int k=1; k<8; k++)
+        result = lanes[k] > result ? lanes[k] : result;
+    if(j < end) {
+        tail = sorRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+
+/**
+ * @brief AVX-512 version of sorRowRBFloat
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+float sorRowAVX512Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m512 quarter = _mm512_set1_ps(0.25f);
+    const __m512 vOmega = _mm512_set1_ps(omega);
+    const __m512 vRest = _mm512_set1_ps(1 - omega);
+    const __m512i westIdx = _mm512_set_epi32(30, 29, 28, 27, 26, 25, 24, 23,
+        22, 21, 20, 19, 18, 17, 16, 15);
+    const __m512i eastIdx = _mm512_set_epi32(16, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1);
+    __m512 maxDelta = _mm512_setzero_ps();
+    __m512 cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512 prev = _mm512_set1_ps(row[start-1]);
+    float result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+31
+    if(j+31 < end)
+        cur = _mm512_loadu_ps(&row[j]);
+    for(; j+31<end; j+=16) {
+        next = _mm512_loadu_ps(&row[j+16]);
+        west = _mm512_permutex2var_ps(prev, westIdx, cur);
+        east = _mm512_permutex2var_ps(cur, eastIdx, next);
+        val = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(
+            _mm512_loadu_ps(&above[j]), _mm512_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_add_ps(_mm512_mul_ps(vOmega, _mm512_mul_ps(val, quarter)),
+            _mm512_mul_ps(vRest, cur));
+        val = _mm512_mask_blend_ps(0x5555, cur, val);
+        _mm512_mask_storeu_ps(&row[j], 0x5555, val);
+        maxDelta = _mm512_max_ps(maxDelta,
+            _mm512_abs_ps(_mm512_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_ps(maxDelta);
+    if(j < end) {
+        tail = sorRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+/**
+ * @brief Picks the kernel to use. KERNEL_SIMD is replaced with the widest
+ *         kernel the CPU supports
+ * @param kernel the kernel asked for
+ * @return the kernel to use, or -1 if this CPU cannot run the one asked for
+ */
+int resolveKernel(Kernel kernel) {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    switch(kernel) {
+        case KERNEL_SIMD:
+            if(__builtin_cpu_supports("avx512f"))
+                return KERNEL_AVX512;
+            if(__builtin_cpu_supports("avx2"))
+                return KERNEL_AVX2;
+            return __builtin_cpu_supports("sse2") ? KERNEL_SSE2 : KERNEL_RB;
+        case KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2") ? KERNEL_SSE2 : -1;
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? KERNEL_AVX2 : -1;
+        case KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f") ? KERNEL_AVX512 : -1;
+        default:
+            return kernel;
+    }
+#else
+    if(kernel == KERNEL_SIMD)
+        return KERNEL_RB;
+    return kernel == KERNEL_GS || kernel == KERNEL_RB ? (int)kernel : -1;
+#endif
+}
+
+/**
+ * @brief Gets the function that relaxes a row for a resolved kernel
+ * @param kernel kernel returned by resolveKernel
+ * @param over whether omega may be other than 1, so the cells need to be
+ *         over-relaxed. The plain kernels are cheaper when it never is
+ * @return pointer to the row function
+ */
+RowKernel rowKernel(Kernel kernel, bool over) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return over ? sorRowSSE2 : relaxRowSSE2;
+        case KERNEL_AVX2:
+            return over ? sorRowAVX2 : relaxRowAVX2;
+        case KERNEL_AVX512:
+            return over ? sorRowAVX512 : relaxRowAVX512;
+#endif
+        case KERNEL_GS:
+            return over ? sorRowGS : relaxRowGS;
+        default:
+            return over ? sorRowRB : relaxRowRB;
+    }
+}
+
+/**
+ * @brief Gets the function that relaxes a row for a resolved kernel without
+ *         finding the changes made
+ * @param kernel kernel returned by resolveKernel
+ * @param over whether omega may be other than 1, so the cells need to be
+ *         over-relaxed
+ * @return pointer to the row function
+ */
+UncheckedRowKernel uncheckedRowKernel(Kernel kernel, bool over) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return over ? sorRowSSE2Unchecked : relaxRowSSE2Unchecked;
+        case KERNEL_AVX2:
+            return over ? sorRowAVX2Unchecked : relaxRowAVX2Unchecked;
+        case KERNEL_AVX512:
+            return over ? sorRowAVX512Unchecked : relaxRowAVX512Unchecked;
+#endif
+        case KERNEL_GS:
+            return over ? sorRowGSUnchecked : relaxRowGSUnchecked;
+        default:
+            return over ? sorRowRBUnchecked : relaxRowRBUnchecked;
+    }
+}
+
+/**
+ * @brief Gets the function that relaxes a row of floats for a resolved kernel
+ * @param kernel kernel returned by resolveKernel
+ * @param over whether omega may be other than 1, so the cells need to be
+ *         over-relaxed. The plain kernels are cheaper when it never is
+ * @return pointer to the row function
+ */
+FloatRowKernel floatRowKernel(Kernel kernel, bool over) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return over ? sorRowSSE2Float : relaxRowSSE2Float;
+        case KERNEL_AVX2:
+            return over ? sorRowAVX2Float : relaxRowAVX2Float;
+        case KERNEL_AVX512:
+            return over ? sorRowAVX512Float : relaxRowAVX512Float;
+#endif
+        case KERNEL_GS:
+            return over ? sorRowGSFloat : relaxRowGSFloat;
+        default:
+            return over ? sorRowRBFloat : relaxRowRBFloat;
+    }
+}
+
+/**
+ * @brief Parses the name of a kernel given with -k
+ * @param name name of the kernel
+ * @return the kernel, or -1 if the name is not recognised
+ */
+int parseKernel(const char* name) {
+    const char* names[] = {"gs", "rb", "sse2", "avx2", "avx512", "simd"};
+    for(int i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++)
+        if(strcmp(name, names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief Gets the name of a kernel for printing
+ */
+const char* kernelName(Kernel kernel) {
+    const char* names[] = {"gs", "rb", "sse2", "avx2", "avx512", "simd"};
+    return names[kernel];
+}
+
+/**
+ * @brief Calculates the next Jacobi iterate of part of a row, writing it to a
+ *         separate row rather than updating the row in place
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param out row to write the new values to
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param stream true to write the new values straight to memory, skipping
+ *         the cache
+ * @return the largest absolute change made to any cell
+ */
+double jacobiRow(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    bool stream)
+{
+    double delta, maxDelta = 0;
+
+    (void)stream;
+    for(int j=start; j<end; j++) {
+        out[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabs(out[j]-row[j]);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The SIMD Jacobi kernels rely on every row of out starting on a cache line,
+ *  as newPlane and newSubPlane allocate them, so that whole vectors can be
+ *  stored with non-temporal stores once the first few cells are done.
+ */
+
+/**
+ * @brief SSE2 version of jacobiRow
+ */
+__attribute__((target("sse2")))
+double jacobiRowSSE2(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    bool stream)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    __m128d maxDelta = _mm_setzero_pd();
+    __m128d val;
+    double lanes[2], head;
+    int j = (start + 1) & ~1;
+
+    head = jacobiRow(above, row, below, out, start, j < end ? j : end, false);
+    for(; j+1<end; j+=2) {
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(
+            _mm_loadu_pd(&above[j]), _mm_loadu_pd(&below[j])),
+            _mm_loadu_pd(&row[j-1])), _mm_loadu_pd(&row[j+1])), quarter);
+        if(stream)
+            _mm_stream_pd(&out[j], val);
+        else
+            _mm_store_pd(&out[j], val);
+        maxDelta = _mm_max_pd(maxDelta,
+            _mm_andnot_pd(signMask, _mm_sub_pd(val, _mm_loadu_pd(&row[j]))));
+    }
+
+    _mm_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[0] = lanes[0] > head ? lanes[0] : head;
+    if(j < end) {
+        head = jacobiRow(above, row, below, out, j, end, false);
+        lanes[0] = lanes[0] > head ? lanes[0] : head;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of jacobiRow
+ */
+__attribute__((target("avx2")))
+double jacobiRowAVX2(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    bool stream)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    __m256d maxDelta = _mm256_setzero_pd();
+    __m256d val;
+    double lanes[4], head;
+    int j = (start + 3) & ~3;
+
+    head = jacobiRow(above, row, below, out, start, j < end ? j : end, false);
+    for(; j+3<end; j+=4) {
+        val = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            _mm256_loadu_pd(&row[j-1])), _mm256_loadu_pd(&row[j+1])),
+            quarter);
+        if(stream)
+            _mm256_stream_pd(&out[j], val);
+        else
+            _mm256_store_pd(&out[j], val);
+        maxDelta = _mm256_max_pd(maxDelta, _mm256_andnot_pd(signMask,
+            _mm256_sub_pd(val, _mm256_loadu_pd(&row[j]))));
+    }
+
+    _mm256_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    lanes[0] = lanes[0] > head ? lanes[0] : head;
+    if(j < end) {
+        head = jacobiRow(above, row, below, out, j, end, false);
+        lanes[0] = lanes[0] > head ? lanes[0] : head;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX-512 version of jacobiRow
+ */
+__attribute__((target("avx512f")))
+double jacobiRowAVX512(const double* restrict above,
+    const double* restrict row, const double* restrict below,
+    double* restrict out, int start, int end, bool stream)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    __m512d maxDelta = _mm512_setzero_pd();
+    __m512d val;
+    double result, head;
+    int j = (start + 7) & ~7;
+
+    head = jacobiRow(above, row, below, out, start, j < end ? j : end, false);
+    for(; j+7<end; j+=8) {
+        val = _mm512_mul_pd(_mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            _mm512_loadu_pd(&row[j-1])), _mm512_loadu_pd(&row[j+1])),
+            quarter);
+        if(stream)
+            _mm512_stream_pd(&out[j], val);
+        else
+            _mm512_store_pd(&out[j], val);
+        maxDelta = _mm512_max_pd(maxDelta,
+            _mm512_abs_pd(_mm512_sub_pd(val, _mm512_loadu_pd(&row[j]))));
+    }
+
+    result = _mm512_reduce_max_pd(maxDelta);
+    result = result > head ? result : head;
+    if(j < end) {
+        head = jacobiRow(above, row, below, out, j, end, false);
+        result = result > head ? result : head;
+    }
+    return result;
+}
+#endif
+
+/**
+ * @brief Gets the function that calculates the next Jacobi iterate of a row.
+ *         The instruction set of the kernel is used, ignoring its ordering
+ * @param kernel kernel returned by resolveKernel
+ * @return pointer to the row function
+ */
+JacobiRowKernel jacobiKernel(Kernel kernel) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return jacobiRowSSE2;
+        case KERNEL_AVX2:
+            return jacobiRowAVX2;
+        case KERNEL_AVX512:
+            return jacobiRowAVX512;
+#endif
+        default:
+            return jacobiRow;
+    }
+}
+
+/**
+ * @brief Decides whether planes of a given size are too big to stay in the
+ *         last level cache between iterations, so are better written with
+ *         non-temporal stores
+ * @param bytes total size of the planes being read and written
+ * @return true if the planes should be streamed to memory
+ */
+bool shouldStream(size_t bytes) {
+    long cacheSize = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if(cacheSize <= 0)
+        cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return cacheSize > 0 && bytes > (size_t)cacheSize;
+}
+
+/**
+ * @brief Parses the name of a method given with -m
+ * @param name name of the method
+ * @return the method, or -1 if the name is not recognised
+ */
+int parseMethod(const char* name) {
+    const char* names[] = {"relax", "jacobi", "sor", "mg", "cg", "pipecg",
+        "chebyshev", "dst"};
+    for(int i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++)
+        if(strcmp(name, names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief Gets the name of a method for printing
+ */
+const char* methodName(Method method) {
+    const char* names[] = {"relax", "jacobi", "sor", "mg", "cg", "pipecg",
+        "chebyshev", "dst"};
+    return names[method];
+}
+
+/**
+ * @brief Parses the name of a way to swap edge rows given with -a
+ * @param name name of the way to swap edge rows
+ * @return the HaloMode, or -1 if the name is not recognised
+ */
+int parseHalo(const char* name) {
+    const char* names[] = {"p2p", "rma", "shared", "graph"};
+    for(int i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++)
+        if(strcmp(name, names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief Gets the name of a way to swap edge rows for printing
+ */
+const char* haloName(HaloMode mode) {
+    const char* names[] = {"p2p", "rma", "shared", "graph"};
+    return names[mode];
+}
+
+/**
+ * @brief Gets the lowest world rank of the processes sharing some hardware
+ *         with this one, which names that hardware the same on all of them
+ * @param type what the processes share, as given to MPI_Comm_split_type
+ * @param world_rank rank of this process in MPI_COMM_WORLD
+ * @return the lowest world rank sharing it, or world_rank if MPI cannot tell
+ */
+int hardwareLeader(int type, int world_rank) {
+    MPI_Comm shared;
+    int leader = world_rank;
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, type, world_rank, MPI_INFO_NULL,
+        &shared);
+    if(shared == MPI_COMM_NULL)
+        return leader;
+    MPI_Allreduce(MPI_IN_PLACE, &leader, 1, MPI_INT, MPI_MIN, shared);
+    MPI_Comm_free(&shared);
+    return leader;
+}
+
+/**
+ * @brief Orders the processes by node, then by socket where MPI can tell,
+ *         then by world rank. Neighbouring rows are then held on the same
+ *         node and socket wherever possible, so only the edge rows at each
+ *         node boundary cross the network, whichever order the launcher
+ *         handed out the ranks in
+ * @return communicator with every process, in the order they hold the rows
+ */
+MPI_Comm newPlaneComm(void) {
+    int world_rank, world_size, position = 0;
+    int place[2];
+    int* places;
+    MPI_Comm comm;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    place[0] = hardwareLeader(MPI_COMM_TYPE_SHARED, world_rank);
+#ifdef OPEN_MPI
+    place[1] = hardwareLeader(OMPI_COMM_TYPE_SOCKET, world_rank);
+#else
+    place[1] = place[0];
+#endif
+
+    // Count the processes that come before this one
+    places = ( int* )malloc((size_t)world_size * 2 * sizeof(int));
+    MPI_Allgather(place, 2, MPI_INT, places, 2, MPI_INT, MPI_COMM_WORLD);
+    for(int r=0; r<world_size; r++) {
+        if(places[2*r] != place[0]) {
+            position += places[2*r] < place[0];
+        } else if(places[2*r+1] != place[1]) {
+            position += places[2*r+1] < place[1];
+        } else {
+            position += r < world_rank;
+        }
+    }
+    free(places);
+
+    MPI_Comm_split(MPI_COMM_WORLD, 0, position, &comm);
+    return comm;
+}
+
+/**
+ * @brief Gets the best over-relaxation factor for red-black SOR
+ * @param rhoJacobi spectral radius of Jacobi iteration on the plane
+ * @return the over-relaxation factor
+ */
+double optimalOmega(double rhoJacobi) {
+    return 2/(1 + sqrt(1 - rhoJacobi*rhoJacobi));
+}
+
+/**
+ * @brief Sets up the over-relaxation factor for a plane
+ * @param mode how the over-relaxation factor is chosen
+ * @param omega over-relaxation factor to use if mode is OMEGA_FIXED
+ * @param sizeOfPlane number of rows and length of each row in the plane
+ * @return the over-relaxation factor and the state needed to estimate it
+ */
+OmegaEstimate newOmegaEstimate(OmegaMode mode, double omega, int sizeOfPlane)
+{
+    OmegaEstimate estimate = {1, true, false, 2, 0, 0, 0};
+
+    if(mode == OMEGA_FIXED) {
+        estimate.omega = omega;
+        estimate.over = omega != 1;
+        return estimate;
+    }
+    // Jacobi's spectral radius for the 5-point Laplacian on this grid
+    estimate.limit = optimalOmega(cos(M_PI/(sizeOfPlane-1)));
+    if(mode == OMEGA_GRID) {
+        estimate.omega = estimate.limit;
+    } else {
+        // Start as Gauss-Seidel, and raise omega once the decay is measured
+        estimate.estimating = true;
+    }
+    return estimate;
+}
+
+/**
+ * @brief Updates the estimate of the best over-relaxation factor from the
+ *         largest change made in the last iteration. Once the ratio between
+ *         successive changes settles it is the spectral radius of SOR with
+ *         the current omega, from which Jacobi's spectral radius and so a
+ *         better omega can be worked out. This repeats until the new omega
+ *         stops improving, or the ratio shows omega is past its best. Close
+ *         to the optimum the decay is dominated by complex eigenvalues and
+ *         the ratio overstates Jacobi's spectral radius, so omega is held
+ *         at the grid's optimum rather than overshooting it
+ * @param estimate the estimate to update
+ * @param maxDelta largest change made by any cell in the whole plane in the
+ *         last iteration
+ */
+void updateOmega(OmegaEstimate* estimate, double maxDelta) {
+    double ratio, rhoJacobi, omega = estimate->omega;
+
+    if(!estimate->estimating)
+        return;
+
+    estimate->samples++;
+    ratio = estimate->lastDelta > 0 ? maxDelta/estimate->lastDelta : 0;
+    if(estimate->samples > OMEGA_MIN_SAMPLES && ratio < 1 &&
+        fabs(ratio - estimate->lastRatio) < OMEGA_SETTLED * (1 - ratio))
+    {
+        if(ratio > omega - 1) {
+            rhoJacobi = (ratio + omega - 1) / (omega * sqrt(ratio));
+            omega = optimalOmega(rhoJacobi < 1 ? rhoJacobi : 1);
+        }
+        // Stop once omega is no longer getting noticeably better
+        if(omega >= estimate->limit) {
+            estimate->omega = estimate->limit;
+            estimate->estimating = false;
+        } else if(omega - estimate->omega <
+            OMEGA_SETTLED * (2 - estimate->omega))
+        {
+            estimate->estimating = false;
+        } else {
+            estimate->omega = omega;
+            estimate->samples = 0;
+        }
+    }
+    estimate->lastRatio = ratio;
+    estimate->lastDelta = maxDelta;
+}
+
+/**
+ * @brief Parses the over-relaxation factor given with -w
+ * @param arg a number, "grid" or "estimate"
+ * @param omega set to the number given, if any
+ * @return how omega should be chosen, or -1 if it is not recognised
+ */
+int parseOmega(const char* arg, double* omega) {
+    char* end;
+    if(strcmp(arg, "grid") == 0)
+        return OMEGA_GRID;
+    if(strcmp(arg, "estimate") == 0)
+        return OMEGA_ESTIMATE;
+    *omega = strtod(arg, &end);
+    // SOR only converges for omega strictly between 0 and 2
+    if(*end != '\0' || *omega <= 0 || *omega >= 2)
+        return -1;
+    return OMEGA_FIXED;
+}
+
+/**
+ * @brief Parses the number of iterations between convergence checks given
+ *         with -c
+ * @param arg a number of at least 1, or "adaptive"
+ * @return the number of iterations, CHECK_ADAPTIVE, or 0 if it is not
+ *          recognised
+ */
+int parseCheck(const char* arg) {
+    char* end;
+    long interval;
+    if(strcmp(arg, "adaptive") == 0)
+        return CHECK_ADAPTIVE;
+    interval = strtol(arg, &end, 10);
+    if(*end != '\0' || interval < 1)
+        return 0;
+    return (int)interval;
+}
+
+/**
+ * @brief Sets up the schedule of convergence checks
+ * @param checkInterval number of iterations between checks, or CHECK_ADAPTIVE
+ * @return the schedule, starting with a check after the first iteration if
+ *          it is adaptive
+ */
+CheckSchedule newCheckSchedule(int checkInterval) {
+    CheckSchedule schedule = {checkInterval, false, 0};
+
+    if(checkInterval == CHECK_ADAPTIVE) {
+        schedule.interval = 1;
+        schedule.adaptive = true;
+    }
+    return schedule;
+}
+
+/**
+ * @brief Gets the most iterations that can be done between two checks
+ */
+int maxCheckInterval(const CheckSchedule* schedule) {
+    return schedule->adaptive ? CHECK_MAX : schedule->interval;
+}
+
+/**
+ * @brief Picks the number of iterations before the next adaptive check. The
+ *         decay of the change since the last check predicts how many more
+ *         iterations are needed, and the interval may double but never goes
+ *         past that, so few iterations are wasted after converging
+ * @param schedule the schedule to update
+ * @param maxDelta largest change made in the last iteration before this check
+ * @param iterations number of iterations done since the last check
+ * @param tolerance the tolerance being relaxed to
+ */
+void nextCheck(CheckSchedule* schedule, double maxDelta, int iterations,
+    double tolerance)
+{
+    double rate, remaining, interval;
+
+    if(!schedule->adaptive)
+        return;
+
+    if(schedule->lastDelta > 0 && maxDelta > 0 &&
+        maxDelta < schedule->lastDelta)
+    {
+        rate = pow(maxDelta/schedule->lastDelta, 1.0/iterations);
+        remaining = log(tolerance/maxDelta)/log(rate);
+        interval = 2.0 * schedule->interval;
+        interval = remaining < interval ? remaining : interval;
+        interval = interval < CHECK_MAX ? interval : CHECK_MAX;
+        schedule->interval = interval > 1 ? (int)interval : 1;
+    } else {
+        // Not converging yet, so check more often until it is
+        schedule->interval = schedule->interval > 1 ?
+            schedule->interval/2 : 1;
+    }
+    schedule->lastDelta = maxDelta;
+}
+
+/**
+ * @brief Gets the first column of a row that belongs to a colour, where a
+ *         cell's colour is the parity of the sum of its row and column
+ * @param row index of the row in the whole plane
+ * @param colour 0 for red, 1 for black
+ * @return the first column from 1 with that colour
+ */
+int colourStart(int row, int colour) {
+    return 1 + ((row + 1 + colour) & 1);
+}
+
+/**
+ * @brief Gets how many columns wide a tile of rows can be while it still fits
+ *         in half of the L2 cache, leaving the rest for everything else
+ * @param rows number of rows in the tile
+ * @return the number of columns, which is at least 64
+ */
+int cacheTileWidth(int rows) {
+    long cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long width;
+
+    if(cacheSize <= 0)
+        cacheSize = 256 * 1024;
+    width = cacheSize / 2 / ((long)rows * (long)sizeof(double));
+    return width > 64 ? (int)width : 64;
+}
+
+/**
+ * @brief Applies several sweeps to a block of rows in one pass down them.
+ *         Each sweep trails one row behind the sweep before it, so only the
+ *         few rows around the wavefront need to be in cache rather than the
+ *         whole plane. Rows too long for those few to fit in L2 are split into
+ *         tiles of columns, with each phase's columns shifted one to the left
+ *         of the phase before so every cell still sees its neighbours from
+ *         the right phase. Every row sees exactly the neighbours it would if
+ *         the sweeps were done one after another
+ * @param plane pointer to the 2D array
+ * @param rowStart first row to relax
+ * @param rowEnd row after the last row to relax
+ * @param sizeOfPlane length of each row in the array
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved kernel used to relax each row
+ * @param depth number of sweeps to apply
+ * @param omega over-relaxation factor, where 1 is plain relaxation
+ * @param sweepDelta filled with the largest change made by each sweep, or
+ *         NULL if none of the sweeps are checked, so the changes are not found
+ */
+void relaxWavefront(double** plane, int rowStart, int rowEnd, int sizeOfPlane,
+    int firstRow, Kernel kernel, int depth, double omega, double* sweepDelta)
+{
+    RowKernel relaxRow = rowKernel(kernel, omega != 1);
+    UncheckedRowKernel uncheckedRow = uncheckedRowKernel(kernel, omega != 1);
+    // Red-black needs a separate pass for each colour of a sweep
+    int passes = kernel == KERNEL_GS ? 1 : 2;
+    int phases = depth * passes;
+    // The rows being relaxed by each phase, plus the ones either side
+    int width = cacheTileWidth(phases + 2);
+    int last = sizeOfPlane-1;
+    int i, p, start, end;
+    double delta;
+
+    for(p=0; p<depth && sweepDelta != NULL; p++)
+        sweepDelta[p] = 0;
+
+    // The last tile ends once the last phase has reached the end of the rows
+    for(int tile=1; tile-phases+1<last; tile+=width) {
+        for(int step=rowStart; step<rowEnd+phases-1; step++) {
+            /* Phase p relaxes row step-p. Going through the phases in order
+                means the row below has already had the previous phase
+                applied, and the row above has not yet had the next one */
+            for(p=step-rowEnd+1 > 0 ? step-rowEnd+1 : 0;
+                p<phases && step-p>=rowStart; p++)
+            {
+                i = step-p;
+                start = tile-p > 1 ? tile-p : 1;
+                end = tile+width-p < last ? tile+width-p : last;
+                if(passes == 2)
+                    start += (start - colourStart(firstRow+i, p%2)) & 1;
+                if(start >= end)
+                    continue;
+                if(sweepDelta == NULL) {
+                    uncheckedRow(plane[i-1], plane[i], plane[i+1], start, end,
+                        omega);
+                    continue;
+                }
+                delta = relaxRow(plane[i-1], plane[i], plane[i+1], start, end,
+                    omega);
+                if(delta > sweepDelta[p/passes])
+                    sweepDelta[p/passes] = delta;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Starts swapping rows with the processes above and below this one.
+ *         The rows must not be touched until the requests have completed
+ * @param sendUp first cell of the row sent to the process above
+ * @param recvUp first cell of the row received from the process above
+ * @param sendDown first cell of the row sent to the process below
+ * @param recvDown first cell of the row received from the process below
+ * @param count number of cells in each row swapped
+ * @param type MPI datatype of each cell
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param requests four requests to wait on, which are null for any process
+ *         that is not there
+ */
+void startRows(void* sendUp, void* recvUp, void* sendDown, void* recvDown,
+    int count, MPI_Datatype type, int world_rank, int world_size,
+    MPI_Request* requests)
+{
+    for(int i=0; i<4; i++)
+        requests[i] = MPI_REQUEST_NULL;
+
+    // Receives are posted first, so the messages have somewhere to land
+    if(world_rank > 0) {
+        MPI_Irecv(recvUp, count, type, world_rank-1, 0, planeComm,
+            &requests[0]);
+        MPI_Isend(sendUp, count, type, world_rank-1, 0, planeComm,
+            &requests[1]);
+    }
+    if(world_rank < world_size-1) {
+        MPI_Irecv(recvDown, count, type, world_rank+1, 0, planeComm,
+            &requests[2]);
+        MPI_Isend(sendDown, count, type, world_rank+1, 0, planeComm,
+            &requests[3]);
+    }
+}
+
+/**
+ * @brief Swaps rows with the processes above and below this one
+ * @param sendUp first cell of the row sent to the process above
+ * @param recvUp first cell of the row received from the process above
+ * @param sendDown first cell of the row sent to the process below
+ * @param recvDown first cell of the row received from the process below
+ * @param count number of cells in each row swapped
+ * @param type MPI datatype of each cell
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ */
+void exchangeRows(void* sendUp, void* recvUp, void* sendDown, void* recvDown,
+    int count, MPI_Datatype type, int world_rank, int world_size)
+{
+    MPI_Request requests[4];
+
+    // A single process has no neighbours to swap with
+    if(world_size == 1)
+        return;
+
+    startRows(sendUp, recvUp, sendDown, recvDown, count, type, world_rank,
+        world_size, requests);
+    MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+}
+
+/**
+ * @brief Starts swapping the edge rows of this process's part of a float
+ *         copy of the plane with the processes above and below it
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param requests four requests to wait on before the edge rows are used
+ */
+void startHalosFloat(float** plane, int numRows, int sizeOfPlane,
+    int world_rank, int world_size, MPI_Request* requests)
+{
+    startRows(&plane[1][1], &plane[0][1], &plane[numRows-2][1],
+        &plane[numRows-1][1], sizeOfPlane-2, MPI_FLOAT, world_rank,
+        world_size, requests);
+}
+
+/**
+ * @brief Moves an array into memory shared by the processes on this node, and
+ *         points its edge rows at the rows they are copies of in any
+ *         neighbour on the same node, so those are read in place
+ * @param halos the state being made by newHaloExchange
+ */
+void shareHaloRows(HaloExchange* halos) {
+    double** plane = halos->plane;
+    int numRows = halos->numRows;
+    int stride = halos->stride;
+    int world_rank = halos->world_rank;
+    int neighbours[2] = {world_rank-1, world_rank+1}, nodeRanks[2];
+    MPI_Group world, node;
+    MPI_Aint size;
+    int dispUnit;
+    double* base;
+    double* theirs;
+
+    MPI_Comm_split_type(planeComm, MPI_COMM_TYPE_SHARED, world_rank,
+        MPI_INFO_NULL, &halos->node);
+    MPI_Win_allocate_shared((MPI_Aint)numRows * stride
+        * (MPI_Aint)sizeof(double), sizeof(double), MPI_INFO_NULL,
+        halos->node, &base, &halos->window);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, halos->window);
+
+    // The array is moved back to where it was once the swapping is done
+    halos->rows = plane[0];
+    for(int i=0; i<numRows; i++) {
+        memcpy(&base[i*stride], plane[i], (size_t)stride * sizeof(double));
+        plane[i] = &base[(size_t)i*(size_t)stride];
+    }
+
+    // Only the first and last processes are missing a neighbour
+    MPI_Comm_group(planeComm, &world);
+    MPI_Comm_group(halos->node, &node);
+    MPI_Group_translate_ranks(world, world_rank > 0 ? 1 : 0, &neighbours[0],
+        node, &nodeRanks[0]);
+    MPI_Group_translate_ranks(world, world_rank < halos->world_size-1 ? 1 : 0,
+        &neighbours[1], node, &nodeRanks[1]);
+    MPI_Group_free(&world);
+    MPI_Group_free(&node);
+    halos->sharedAbove = world_rank > 0 && nodeRanks[0] != MPI_UNDEFINED;
+    halos->sharedBelow = world_rank < halos->world_size-1
+        && nodeRanks[1] != MPI_UNDEFINED;
+
+    // The bottom edge row of the process above is its last but one row
+    if(halos->sharedAbove) {
+        MPI_Win_shared_query(halos->window, nodeRanks[0], &size, &dispUnit,
+            &theirs);
+        plane[0] = &theirs[size/(MPI_Aint)sizeof(double) - 2*stride];
+    }
+    if(halos->sharedBelow) {
+        MPI_Win_shared_query(halos->window, nodeRanks[1], &size, &dispUnit,
+            &theirs);
+        plane[numRows-1] = &theirs[stride];
+    }
+
+    // Every array must be filled in before its neighbours read from it
+    MPI_Win_sync(halos->window);
+    MPI_Barrier(halos->node);
+}
+
+/**
+ * @brief Sets up the requests that swap the edge rows once, so each swap only
+ *         starts them again. Edge rows shared with a neighbour on the same
+ *         node are not sent, but an empty message still says they are ready
+ * @param halos the state being made by newHaloExchange
+ */
+void initHaloRequests(HaloExchange* halos) {
+    double** plane = halos->plane;
+    int last = halos->numRows-2;
+    int count = halos->sizeOfPlane-2;
+    int world_rank = halos->world_rank;
+    int n = 0;
+
+    // Receives are started first, so the messages have somewhere to land
+    if(world_rank > 0) {
+        MPI_Recv_init(&plane[0][1], halos->sharedAbove ? 0 : count,
+            MPI_DOUBLE, world_rank-1, 0, planeComm, &halos->requests[n++]);
+        MPI_Send_init(&plane[1][1], halos->sharedAbove ? 0 : count,
+            MPI_DOUBLE, world_rank-1, 0, planeComm, &halos->requests[n++]);
+    }
+    if(world_rank < halos->world_size-1) {
+        MPI_Recv_init(&plane[last+1][1], halos->sharedBelow ? 0 : count,
+            MPI_DOUBLE, world_rank+1, 0, planeComm, &halos->requests[n++]);
+        MPI_Send_init(&plane[last][1], halos->sharedBelow ? 0 : count,
+            MPI_DOUBLE, world_rank+1, 0, planeComm, &halos->requests[n++]);
+    }
+    halos->numRequests = n;
+}
+
+/**
+ * @brief Describes the processes this one swaps edge rows with as a graph, so
+ *         one neighbourhood collective swaps them all, however many there are
+ * @param halos the state being made by newHaloExchange
+ */
+void graphHaloRows(HaloExchange* halos) {
+    int world_rank = halos->world_rank;
+    int stride = halos->stride;
+    int last = halos->numRows-2;
+    int neighbours[2], weights[2] = {1, 1};
+    int n = 0;
+
+    /* Each edge row goes to the neighbour its copy comes from, so the same
+        list is both sources and destinations. The offsets are from the
+        first edge row sent and the first edge row received */
+    if(world_rank > 0) {
+        neighbours[n] = world_rank-1;
+        halos->sendDispls[n] = 0;
+        halos->recvDispls[n] = 0;
+        halos->counts[n++] = halos->sizeOfPlane-2;
+    }
+    if(world_rank < halos->world_size-1) {
+        neighbours[n] = world_rank+1;
+        halos->sendDispls[n] = (last-1) * stride;
+        halos->recvDispls[n] = (last+1) * stride;
+        halos->counts[n++] = halos->sizeOfPlane-2;
+    }
+    /* The rows are already split by world_rank, so nothing is reordered.
+        Every edge row is the same size, so the edges weigh the same */
+    MPI_Dist_graph_create_adjacent(planeComm, n, neighbours, weights,
+        n, neighbours, weights, MPI_INFO_NULL, 0, &halos->graph);
+    halos->numRequests = 1;
+}
+
+/**
+ * @brief Sets up swapping the edge rows of an array. With HALO_RMA the whole
+ *         array is exposed in a window, and the window is synchronised with
+ *         just the processes above and below, rather than with a fence. With
+ *         HALO_SHARED the edge rows held from neighbours on the same node are
+ *         their rows themselves, and swapping only says they are up to date.
+ *         With HALO_GRAPH the edge rows are swapped by one
+ *         MPI_Ineighbor_alltoallv over a graph of the neighbours
+ * @param mode how the edge rows are swapped
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @return the state needed to swap the edge rows
+ */
+HaloExchange newHaloExchange(HaloMode mode, double** plane, int numRows,
+    int sizeOfPlane, int world_rank, int world_size)
+{
+    HaloExchange halos;
+    MPI_Group world;
+    int ranks[2], count = 0;
+    int stride = (int)(plane[1]-plane[0]);
+    int aboveRows = 0;
+
+    halos.mode = mode;
+    halos.plane = plane;
+    halos.numRows = numRows;
+    halos.sizeOfPlane = sizeOfPlane;
+    halos.world_rank = world_rank;
+    halos.world_size = world_size;
+    halos.pending = false;
+    halos.stride = stride;
+    halos.numRequests = 0;
+    halos.sharedAbove = false;
+    halos.sharedBelow = false;
+    // A single process has no neighbours to share with, so needs no window
+    if(world_size == 1)
+        halos.mode = HALO_P2P;
+    if(halos.mode == HALO_SHARED)
+        shareHaloRows(&halos);
+    if(halos.mode == HALO_GRAPH) {
+        graphHaloRows(&halos);
+        return halos;
+    }
+    if(halos.mode != HALO_RMA) {
+        initHaloRequests(&halos);
+        return halos;
+    }
+
+    MPI_Win_create(plane[0], (MPI_Aint)numRows * stride
+        * (MPI_Aint)sizeof(double), sizeof(double), MPI_INFO_NULL,
+        planeComm, &halos.window);
+
+    // The bottom edge row of the process above depends on how many it has
+    MPI_Sendrecv(&numRows, 1, MPI_INT,
+        world_rank < world_size-1 ? world_rank+1 : MPI_PROC_NULL, 0,
+        &aboveRows, 1, MPI_INT,
+        world_rank > 0 ? world_rank-1 : MPI_PROC_NULL, 0, planeComm,
+        MPI_STATUS_IGNORE);
+    halos.aboveLastRow = (MPI_Aint)(aboveRows-1) * stride + 1;
+
+    if(world_rank > 0)
+        ranks[count++] = world_rank-1;
+    if(world_rank < world_size-1)
+        ranks[count++] = world_rank+1;
+    MPI_Comm_group(planeComm, &world);
+    MPI_Group_incl(world, count, ranks, &halos.neighbours);
+    MPI_Group_free(&world);
+    return halos;
+}
+
+/**
+ * @brief Starts swapping the edge rows. Neither the edge rows being sent nor
+ *         those being received may be touched until finishHaloExchange
+ * @param halos the state made by newHaloExchange
+ */
+void startHaloExchange(HaloExchange* halos) {
+    double** plane = halos->plane;
+    int last = halos->numRows-2;
+    int count = halos->sizeOfPlane-2;
+    int world_rank = halos->world_rank;
+
+    halos->pending = true;
+    if(halos->mode == HALO_GRAPH) {
+        MPI_Ineighbor_alltoallv(&plane[1][1], halos->counts,
+            halos->sendDispls, MPI_DOUBLE, &plane[0][1], halos->counts,
+            halos->recvDispls, MPI_DOUBLE, halos->graph, &halos->requests[0]);
+        return;
+    }
+    /* Make the edge rows from here visible to any neighbours on this node
+        before the empty messages tell them, then restart the swap */
+    if(halos->mode != HALO_RMA) {
+        if(halos->mode == HALO_SHARED)
+            MPI_Win_sync(halos->window);
+        MPI_Startall(halos->numRequests, halos->requests);
+        return;
+    }
+
+    /* Let the neighbours put into this process's edge rows, then put into
+        theirs. Nothing is received, so there is nothing to match */
+    MPI_Win_post(halos->neighbours, 0, halos->window);
+    MPI_Win_start(halos->neighbours, 0, halos->window);
+    if(world_rank > 0)
+        MPI_Put(&plane[1][1], count, MPI_DOUBLE, world_rank-1,
+            halos->aboveLastRow, count, MPI_DOUBLE, halos->window);
+    if(world_rank < halos->world_size-1)
+        MPI_Put(&plane[last][1], count, MPI_DOUBLE, world_rank+1, 1,
+            count, MPI_DOUBLE, halos->window);
+}
+
+/**
+ * @brief Waits for the edge rows being swapped to arrive, if any are
+ * @param halos the state made by newHaloExchange
+ */
+void finishHaloExchange(HaloExchange* halos) {
+    if(!halos->pending)
+        return;
+    halos->pending = false;
+
+    if(halos->mode != HALO_RMA) {
+        MPI_Waitall(halos->numRequests, halos->requests, MPI_STATUSES_IGNORE);
+        // The neighbours' writes before they said so are now seen here
+        if(halos->mode == HALO_SHARED)
+            MPI_Win_sync(halos->window);
+    } else {
+        // The puts from here are done, then the puts into here
+        MPI_Win_complete(halos->window);
+        MPI_Win_wait(halos->window);
+    }
+}
+
+/**
+ * @brief Swaps the edge rows and waits for them to arrive
+ * @param halos the state made by newHaloExchange
+ */
+void exchangeHaloRows(HaloExchange* halos) {
+    startHaloExchange(halos);
+    finishHaloExchange(halos);
+}
+
+/**
+ * @brief Frees the state made by newHaloExchange, waiting for any swap that
+ *         is still going
+ * @param halos the state made by newHaloExchange
+ */
+void freeHaloExchange(HaloExchange* halos) {
+    finishHaloExchange(halos);
+    // Persistent requests stay once done, where the graph's request does not
+    for(int i=0; i<halos->numRequests; i++)
+        if(halos->requests[i] != MPI_REQUEST_NULL)
+            MPI_Request_free(&halos->requests[i]);
+    if(halos->mode == HALO_RMA) {
+        MPI_Win_free(&halos->window);
+        MPI_Group_free(&halos->neighbours);
+    } else if(halos->mode == HALO_SHARED) {
+        /* Move the array back, edge rows included, before any neighbour
+            frees the memory those are read from */
+        for(int i=0; i<halos->numRows; i++) {
+            memcpy(&halos->rows[(size_t)i*(size_t)halos->stride],
+                halos->plane[i], (size_t)halos->stride * sizeof(double));
+            halos->plane[i] = &halos->rows[(size_t)i*(size_t)halos->stride];
+        }
+        MPI_Barrier(halos->node);
+        MPI_Win_unlock_all(halos->window);
+        MPI_Win_free(&halos->window);
+        MPI_Comm_free(&halos->node);
+    } else if(halos->mode == HALO_GRAPH) {
+        MPI_Comm_free(&halos->graph);
+    }
+}
+
+/**
+ * @brief Swaps the edge rows of this process's part of the plane with the
+ *         processes above and below it
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ */
+void exchangeHalos(double** plane, int numRows, int sizeOfPlane,
+    int world_rank, int world_size)
+{
+    exchangeRows(&plane[1][1], &plane[0][1], &plane[numRows-2][1],
+        &plane[numRows-1][1], sizeOfPlane-2, MPI_DOUBLE, world_rank,
+        world_size);
+}
+
+/**
+ * @brief Float version of exchangeHalos, which sends half as many bytes
+ * @param plane pointer to the 2D array of floats
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ */
+void exchangeHalosFloat(float** plane, int numRows, int sizeOfPlane,
+    int world_rank, int world_size)
+{
+    exchangeRows(&plane[1][1], &plane[0][1], &plane[numRows-2][1],
+        &plane[numRows-1][1], sizeOfPlane-2, MPI_FLOAT, world_rank,
+        world_size);
+}
+
+/**
+ * @brief Relaxes one colour of this process's rows, relaxing the two edge
+ *         rows first so they can be sent while the rest are relaxed. The
+ *         edge rows must have arrived from the last exchange
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param colour colour of the cells to relax
+ * @param relaxRow red-black function that relaxes part of a row
+ * @param omega over-relaxation factor
+ * @param halos swap of the array's edge rows, which this starts
+ * @return the largest absolute change made to any cell
+ */
+double relaxColourOverlapped(double** plane, int numRows, int sizeOfPlane,
+    int firstRow, int colour, RowKernel relaxRow, double omega,
+    HaloExchange* halos)
+{
+    int last = numRows-2;
+    double delta, maxDelta;
+
+    maxDelta = relaxRow(plane[0], plane[1], plane[2],
+        colourStart(firstRow+1, colour), sizeOfPlane-1, omega);
+    if(last > 1) {
+        delta = relaxRow(plane[last-1], plane[last], plane[last+1],
+            colourStart(firstRow+last, colour), sizeOfPlane-1, omega);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    startHaloExchange(halos);
+
+    // None of these rows need the edge rows that are on their way
+    for(int i=2; i<last; i++) {
+        delta = relaxRow(plane[i-1], plane[i], plane[i+1],
+            colourStart(firstRow+i, colour), sizeOfPlane-1, omega);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Version of relaxColourOverlapped that does not find the changes made,
+ *         for the sweeps between convergence checks
+ */
+void relaxColourOverlappedUnchecked(double** plane, int numRows,
+    int sizeOfPlane, int firstRow, int colour, UncheckedRowKernel relaxRow,
+    double omega, HaloExchange* halos)
+{
+    int last = numRows-2;
+
+    relaxRow(plane[0], plane[1], plane[2], colourStart(firstRow+1, colour),
+        sizeOfPlane-1, omega);
+    if(last > 1)
+        relaxRow(plane[last-1], plane[last], plane[last+1],
+            colourStart(firstRow+last, colour), sizeOfPlane-1, omega);
+    startHaloExchange(halos);
+
+    // None of these rows need the edge rows that are on their way
+    for(int i=2; i<last; i++)
+        relaxRow(plane[i-1], plane[i], plane[i+1],
+            colourStart(firstRow+i, colour), sizeOfPlane-1, omega);
+}
+
+/**
+ * @brief Float version of relaxColourOverlapped
+ */
+float relaxColourOverlappedFloat(float** plane, int numRows, int sizeOfPlane,
+    int world_rank, int world_size, int firstRow, int colour,
+    FloatRowKernel relaxRow, float omega, MPI_Request* requests)
+{
+    int last = numRows-2;
+    float delta, maxDelta;
+
+    maxDelta = relaxRow(plane[0], plane[1], plane[2],
+        colourStart(firstRow+1, colour), sizeOfPlane-1, omega);
+    if(last > 1) {
+        delta = relaxRow(plane[last-1], plane[last], plane[last+1],
+            colourStart(firstRow+last, colour), sizeOfPlane-1, omega);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    startHalosFloat(plane, numRows, sizeOfPlane, world_rank, world_size,
+        requests);
+
+    // None of these rows need the edge rows that are on their way
+    for(int i=2; i<last; i++) {
+        delta = relaxRow(plane[i-1], plane[i], plane[i+1],
+            colourStart(firstRow+i, colour), sizeOfPlane-1, omega);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Goes through the largest change made by each sweep since the last
+ *         check, counting them and updating omega, until one has converged
+ * @param sweepDelta largest change made by each sweep over every process
+ * @param sweeps number of sweeps since the last check
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param iterations number of iterations taken, updated for each sweep
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @param schedule schedule of checks, updated if none converged
+ * @return true if one of the sweeps converged
+ */
+bool checkSweeps(const double* sweepDelta, int sweeps, double tolerance,
+    unsigned long* iterations, OmegaEstimate* omega, CheckSchedule* schedule)
+{
+    for(int i=0; i<sweeps; i++) {
+        (*iterations)++;
+        if(!(tolerance < sweepDelta[i]))
+            return true;
+        updateOmega(omega, sweepDelta[i]);
+    }
+    nextCheck(schedule, sweepDelta[sweeps-1], sweeps, tolerance);
+    return false;
+}
+
+/**
+ * @brief Sets up sharing the rows out by how quickly each process relaxes
+ *         them, starting from how they are shared out now
+ * @param plane the 2D array, replaced when rows move
+ * @param numRows number of rows in the array, updated when rows move
+ * @param firstRow index in the whole plane of the first row in the array,
+ *         updated when rows move
+ * @param interval number of sweeps between each time the rows are shared out
+ * @param sizeOfPlane length of each row in the array
+ * @param world_size number of MPI_processes
+ * @return the state needed to share the rows out
+ */
+Balance newBalance(double*** plane, int* numRows, int* firstRow,
+    int interval, int sizeOfPlane, int world_size)
+{
+    Balance balance;
+    int ownFirst = *firstRow + 1;
+
+    balance.plane = plane;
+    balance.numRows = numRows;
+    balance.firstRow = firstRow;
+    balance.interval = interval;
+    balance.sinceBalance = 0;
+    balance.seconds = 0;
+    // The first row of each process's own, then the bottom edge of the plane
+    balance.bounds = ( int* )malloc((size_t)(world_size+1) * sizeof(int));
+    MPI_Allgather(&ownFirst, 1, MPI_INT, balance.bounds, 1, MPI_INT,
+        planeComm);
+    balance.bounds[world_size] = sizeOfPlane-1;
+    return balance;
+}
+
+/**
+ * @brief Shares the rows out again in proportion to how many each process
+ *         has relaxed per second since they were last shared out. Each
+ *         boundary moves at most half way into the processes either side of
+ *         it, so rows only ever move between neighbours, and large
+ *         differences are evened out over several calls
+ * @param balance the state made by newBalance
+ * @param sizeOfPlane length of each row in the array
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param minRows fewest rows of its own any process may be left with
+ */
+void rebalanceRows(Balance* balance, int sizeOfPlane, int world_rank,
+    int world_size, int minRows)
+{
+    double** plane = *balance->plane;
+    int numRows = *balance->numRows;
+    int firstRow = *balance->firstRow;
+    int stride = (int)(plane[1]-plane[0]);
+    int* bounds = balance->bounds;
+    int* old = ( int* )malloc((size_t)(world_size+1) * sizeof(int));
+    double* speeds = ( double* )malloc((size_t)world_size * sizeof(double));
+    double total = 0, share = 0;
+    MPI_Request requests[4];
+    int n = 0, count, limit, target;
+    double** newPlane;
+    int newFirst, newRows;
+
+    // Rows relaxed per second, as every process does the same sweeps
+    speeds[world_rank] = (numRows-2) / (balance->seconds + 1e-9);
+    MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, speeds, 1, MPI_DOUBLE,
+        planeComm);
+    memcpy(old, bounds, (size_t)(world_size+1) * sizeof(int));
+    for(int i=0; i<world_size; i++)
+        total += speeds[i];
+
+    // Every process works out the same boundaries from the same speeds
+    for(int i=1; i<world_size; i++) {
+        share += speeds[i-1];
+        target = 1 + (int)lround(share / total * (sizeOfPlane-2));
+        limit = old[i]-old[i-1] < old[i+1]-old[i] ? old[i]-old[i-1] :
+            old[i+1]-old[i];
+        limit = limit > minRows ? (limit - minRows) / 2 : 0;
+        if(target < old[i]-limit)
+            target = old[i]-limit;
+        if(target > old[i]+limit)
+            target = old[i]+limit;
+        bounds[i] = target;
+    }
+
+    newFirst = bounds[world_rank]-1;
+    newRows = bounds[world_rank+1]-bounds[world_rank]+2;
+    newPlane = newSubPlane((unsigned int)sizeOfPlane, (unsigned int)newRows);
+
+    /* Take the rows now held here from the neighbour they belonged to, and
+        give it the rows it now holds. Whole rows are sent, as they lie one
+        after the other in both arrays */
+    if(world_rank > 0) {
+        count = old[world_rank]-bounds[world_rank];
+        if(count > 0)
+            MPI_Irecv(newPlane[0], count * stride, MPI_DOUBLE, world_rank-1,
+                3, planeComm, &requests[n++]);
+        count = bounds[world_rank]-old[world_rank];
+        if(count > 0)
+            MPI_Isend(plane[2], count * stride, MPI_DOUBLE, world_rank-1, 3,
+                planeComm, &requests[n++]);
+    }
+    if(world_rank < world_size-1) {
+        count = bounds[world_rank+1]-old[world_rank+1];
+        if(count > 0)
+            MPI_Irecv(newPlane[firstRow+numRows-newFirst], count * stride,
+                MPI_DOUBLE, world_rank+1, 3, planeComm, &requests[n++]);
+        count = old[world_rank+1]-bounds[world_rank+1];
+        if(count > 0)
+            MPI_Isend(plane[bounds[world_rank+1]-1-firstRow], count * stride,
+                MPI_DOUBLE, world_rank+1, 3, planeComm, &requests[n++]);
+    }
+
+    // Rows held both before and after are copied across here
+    for(int i=firstRow > newFirst ? firstRow : newFirst;
+        i<firstRow+numRows && i<newFirst+newRows; i++)
+        memcpy(newPlane[i-newFirst], plane[i-firstRow],
+            (size_t)stride * sizeof(double));
+    MPI_Waitall(n, requests, MPI_STATUSES_IGNORE);
+
+    freePlane(plane);
+    *balance->plane = newPlane;
+    *balance->numRows = newRows;
+    *balance->firstRow = newFirst;
+    balance->sinceBalance = 0;
+    balance->seconds = 0;
+    free(old);
+    free(speeds);
+}
+
+/**
+ * @brief Sets up reducing in two levels, over the processes on each node and
+ *         then over one process from each node
+ * @param count most values reduced at once
+ * @param world_rank world_rank of this process
+ * @return the state needed to reduce
+ */
+NodeReduction newNodeReduction(int count, int world_rank) {
+    NodeReduction reduction;
+    MPI_Aint size;
+    int dispUnit;
+
+    reduction.count = count;
+    MPI_Comm_split_type(planeComm, MPI_COMM_TYPE_SHARED, world_rank,
+        MPI_INFO_NULL, &reduction.node);
+    MPI_Comm_rank(reduction.node, &reduction.nodeRank);
+    MPI_Comm_size(reduction.node, &reduction.nodeSize);
+    // Only the first process on each node reduces between nodes
+    MPI_Comm_split(planeComm, reduction.nodeRank == 0 ? 0 : MPI_UNDEFINED,
+        world_rank, &reduction.leaders);
+
+    // The first process on the node holds the whole array
+    MPI_Win_allocate_shared(reduction.nodeRank == 0 ?
+        (MPI_Aint)(reduction.nodeSize+1) * count * (MPI_Aint)sizeof(double) :
+        0, sizeof(double), MPI_INFO_NULL, reduction.node, &reduction.slots,
+        &reduction.window);
+    MPI_Win_shared_query(reduction.window, 0, &size, &dispUnit,
+        &reduction.slots);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, reduction.window);
+    return reduction;
+}
+
+/**
+ * @brief Finds the largest of each value over every process. The processes
+ *         on a node only synchronise with each other, and only one process
+ *         from each node takes part in the reduction between nodes
+ * @param reduction the state made by newNodeReduction
+ * @param values the values from this process, replaced with the largest
+ * @param n number of values, at most the count given to newNodeReduction
+ */
+void nodeReduceMax(NodeReduction* reduction, double* values, int n) {
+    double* slots = reduction->slots;
+    int count = reduction->count;
+
+    memcpy(&slots[(reduction->nodeRank+1) * count], values,
+        (size_t)n * sizeof(double));
+    MPI_Win_sync(reduction->window);
+    MPI_Barrier(reduction->node);
+    MPI_Win_sync(reduction->window);
+
+    if(reduction->nodeRank == 0) {
+        for(int i=0; i<n; i++) {
+            slots[i] = slots[count+i];
+            for(int p=2; p<=reduction->nodeSize; p++)
+                slots[i] = slots[p*count+i] > slots[i] ? slots[p*count+i] :
+                    slots[i];
+        }
+        MPI_Allreduce(MPI_IN_PLACE, slots, n, MPI_DOUBLE, MPI_MAX,
+            reduction->leaders);
+        MPI_Win_sync(reduction->window);
+    }
+
+    // Every process has read the result before the next values go in
+    MPI_Barrier(reduction->node);
+    MPI_Win_sync(reduction->window);
+    memcpy(values, slots, (size_t)n * sizeof(double));
+}
+
+/**
+ * @brief Frees the state made by newNodeReduction
+ * @param reduction the state made by newNodeReduction
+ */
+void freeNodeReduction(NodeReduction* reduction) {
+    MPI_Win_unlock_all(reduction->window);
+    MPI_Win_free(&reduction->window);
+    if(reduction->leaders != MPI_COMM_NULL)
+        MPI_Comm_free(&reduction->leaders);
+    MPI_Comm_free(&reduction->node);
+}
+
+/**
+ * @brief Performs the relaxation algorithm on a 2D array
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved kernel used to relax each row
+ * @param depth number of sweeps to apply between each exchange of edge rows
+ * @param checkInterval number of sweeps between convergence checks, or
+ *         CHECK_ADAPTIVE
+ * @param lagged whether to reduce the changes while the next sweeps are done,
+ *         so the reduction is hidden but convergence is seen a check late
+ * @param haloMode how the edge rows are swapped
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @param balance state for sharing the rows out by how quickly each process
+ *         relaxes them, which replaces the array, or NULL to keep them as
+ *         they are
+ * @param hierarchical whether to reduce each check over each node first, then
+ *         over one process from each node
+ * @return the number of iterations taken to perform the relaxation algorithm.
+ *          With more than one sweep per check only the last pass before the
+ *          check finds its changes, unless omega is being estimated, so this
+ *          is the first of those sweeps that converged on every process,
+ *          though the sweeps before the next check are done if lagged
+ */
+unsigned long relaxPlane(double** plane, int numRows, int sizeOfPlane,
+    double tolerance, int world_rank, int world_size, int firstRow,
+    Kernel kernel, int depth, int checkInterval, bool lagged,
+    HaloMode haloMode, OmegaEstimate* omega, Balance* balance,
+    bool hierarchical)
+{
+
+    unsigned long iterations = 0;
+    int p, colour, passes, sweeps, unchecked, reducedSweeps = 0, reduced;
+    double delta, maxDelta;
+    // Time spent relaxing, not waiting for edge rows, to share rows out by
+    struct timespec begin, end;
+    long double relaxing = 0;
+
+    int recBot = numRows-1;
+    RowKernel relaxRow = rowKernel(kernel, omega->over);
+    UncheckedRowKernel uncheckedRow = uncheckedRowKernel(kernel, omega->over);
+    HaloExchange halos = newHaloExchange(haloMode, plane, numRows,
+        sizeOfPlane, world_rank, world_size);
+    CheckSchedule schedule = newCheckSchedule(checkInterval);
+    // Whole passes are done, so a check can come up to depth-1 sweeps late
+    size_t maxSweeps = (size_t)(maxCheckInterval(&schedule) + depth);
+    double* sweepDelta = ( double* )malloc(maxSweeps * sizeof(double));
+    // Changes from the last check, being reduced while the next sweeps run
+    double* lastDelta = ( double* )malloc(maxSweeps * sizeof(double));
+    MPI_Request request = MPI_REQUEST_NULL;
+    NodeReduction reduction;
+
+    if(hierarchical)
+        reduction = newNodeReduction((int)maxSweeps, world_rank);
+
+    // Main Loop
+    while(1) {
+        /* Share the rows out again once enough sweeps have been timed. Any
+            swap still going has to finish first, as the rows move */
+        if(balance != NULL && balance->sinceBalance >= balance->interval) {
+            freeHaloExchange(&halos);
+            rebalanceRows(balance, sizeOfPlane, world_rank, world_size,
+                depth > 2 ? depth : 2);
+            plane = *balance->plane;
+            numRows = *balance->numRows;
+            firstRow = *balance->firstRow;
+            recBot = numRows-1;
+            halos = newHaloExchange(haloMode, plane, numRows, sizeOfPlane,
+                world_rank, world_size);
+        }
+
+        passes = (schedule.interval + depth - 1) / depth;
+        sweeps = passes * depth;
+        // Estimating omega needs every sweep's change, not just the last ones
+        unchecked = omega->estimating ? 0 : passes-1;
+
+        for(p=0; p<passes; p++) {
+            // Sweeps that are not checked can never be the one that converged
+            for(int i=0; i<depth && p<unchecked; i++)
+                sweepDelta[p*depth+i] = HUGE_VAL;
+
+            if(kernel != KERNEL_GS && depth == 1 && p < unchecked) {
+                for(colour=0; colour<2; colour++) {
+                    finishHaloExchange(&halos);
+                    clock_gettime(CLOCK_MONOTONIC, &begin);
+                    relaxColourOverlappedUnchecked(plane, numRows,
+                        sizeOfPlane, firstRow, colour, uncheckedRow,
+                        omega->omega, &halos);
+                    clock_gettime(CLOCK_MONOTONIC, &end);
+                    relaxing += toSeconds(begin, end);
+                }
+            } else if(kernel != KERNEL_GS && depth == 1) {
+                maxDelta = 0;
+                /* Relax all of the red cells, then all of the black cells.
+                    The edge rows are swapped after each colour, so every
+                    process sees the same values it would if it had the whole
+                    plane, while the rows between them are relaxed */
+                for(colour=0; colour<2; colour++) {
+                    finishHaloExchange(&halos);
+                    clock_gettime(CLOCK_MONOTONIC, &begin);
+                    delta = relaxColourOverlapped(plane, numRows,
+                        sizeOfPlane, firstRow, colour, relaxRow, omega->omega,
+                        &halos);
+                    clock_gettime(CLOCK_MONOTONIC, &end);
+                    relaxing += toSeconds(begin, end);
+                    maxDelta = delta > maxDelta ? delta : maxDelta;
+                }
+                sweepDelta[p] = maxDelta;
+            } else {
+                /* Perform relaxation. With more than one sweep the edge rows
+                    from the neighbouring processes stay the same for the
+                    whole block. Gauss-Seidel order needs every row before
+                    the last, so there is nothing to overlap the swap with */
+                finishHaloExchange(&halos);
+                clock_gettime(CLOCK_MONOTONIC, &begin);
+                relaxWavefront(plane, 1, recBot, sizeOfPlane, firstRow,
+                    kernel, depth, omega->omega,
+                    p < unchecked ? NULL : &sweepDelta[p*depth]);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                relaxing += toSeconds(begin, end);
+                exchangeHaloRows(&halos);
+            }
+            /* Let the reduction from the last check progress. Every process
+                still does the whole block whatever it finds, as stopping
+                part way would leave the others waiting on its edge rows */
+            MPI_Test(&request, &reduced, MPI_STATUS_IGNORE);
+        }
+        if(balance != NULL) {
+            balance->seconds += (double)relaxing;
+            balance->sinceBalance += sweeps;
+        }
+        relaxing = 0;
+
+        /* Find the largest change made by each sweep since the last check
+            over all of the MPI processes, which says both whether they have
+            finished and how quickly they are converging */
+        if(!lagged) {
+            if(hierarchical)
+                nodeReduceMax(&reduction, sweepDelta, sweeps);
+            else
+                MPI_Allreduce(MPI_IN_PLACE, sweepDelta, sweeps, MPI_DOUBLE,
+                    MPI_MAX, planeComm);
+            if(checkSweeps(sweepDelta, sweeps, tolerance, &iterations, omega,
+                &schedule))
+                break;
+            continue;
+        }
+
+        // Lagged, so act on the last check's changes and start on these
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        if(reducedSweeps > 0 && checkSweeps(lastDelta, reducedSweeps,
+            tolerance, &iterations, omega, &schedule))
+            break;
+        memcpy(lastDelta, sweepDelta, (size_t)sweeps * sizeof(double));
+        reducedSweeps = sweeps;
+        MPI_Iallreduce(MPI_IN_PLACE, lastDelta, sweeps, MPI_DOUBLE, MPI_MAX,
+            planeComm, &request);
+    }
+
+    // The plane is left with the edge rows from the last sweep
+    freeHaloExchange(&halos);
+    if(hierarchical)
+        freeNodeReduction(&reduction);
+    free(sweepDelta);
+    free(lastDelta);
+    return iterations;
+}
+
+/**
+ * @brief Performs the relaxation algorithm without ever waiting on the
+ *         processes above and below. Each process keeps sweeping with
+ *         whichever of their edge rows have arrived, and sends its own
+ *         whenever the last ones have gone. A process goes idle once a sweep
+ *         changes nothing by more than the tolerance and it has nothing left
+ *         to send, and only sweeps again if new edge rows wake it. Whether
+ *         every process is idle, with no edge rows on the way that could wake
+ *         one, is found by passing a token around them (Safra's algorithm)
+ *         rather than by reducing over all of them
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved kernel used to relax each row
+ * @return the most sweeps done by any process
+ */
+unsigned long asyncRelaxPlane(double** plane, int numRows, int sizeOfPlane,
+    double tolerance, int world_rank, int world_size, int firstRow,
+    Kernel kernel)
+{
+    int count = sizeOfPlane-2;
+    int last = numRows-2;
+    int neighbours[2] = {world_rank-1, world_rank+1};
+    bool exists[2] = {world_rank > 0, world_rank < world_size-1};
+    double* edges[2] = {&plane[1][1], &plane[last][1]};
+    double* halos[2] = {&plane[0][1], &plane[last+1][1]};
+    double* sendRows[2];
+    double* recvRows[2];
+    // Rows from above and below, then the token, then the signal to stop
+    MPI_Request recvs[4];
+    MPI_Request sends[3];
+    /* The token carries how many edge rows have been sent but not received
+        by the processes it has passed, and whether any of them received
+        one since it last passed */
+    int tokenIn[2], tokenOut[2] = {0, 0};
+    int messages = 0;
+    bool black = false, holding = world_rank == 0, firstRound = true;
+    bool active = true, stopped = false, dirty[2] = {false, false};
+    unsigned long sweeps = 0;
+    int done, side;
+    double delta;
+
+    for(side=0; side<2; side++) {
+        sendRows[side] = ( double* )malloc((size_t)count * sizeof(double));
+        recvRows[side] = ( double* )malloc((size_t)count * sizeof(double));
+    }
+    for(int i=0; i<4; i++)
+        recvs[i] = MPI_REQUEST_NULL;
+    for(int i=0; i<3; i++)
+        sends[i] = MPI_REQUEST_NULL;
+    for(side=0; side<2; side++)
+        if(exists[side])
+            MPI_Irecv(recvRows[side], count, MPI_DOUBLE, neighbours[side], 4,
+                planeComm, &recvs[side]);
+    if(!holding)
+        MPI_Irecv(tokenIn, 2, MPI_INT, (world_rank+world_size-1) % world_size,
+            5, planeComm, &recvs[2]);
+    if(world_rank > 0)
+        MPI_Irecv(NULL, 0, MPI_INT, 0, 6, planeComm, &recvs[3]);
+
+    while(!stopped) {
+        // Take in every edge row that has arrived, keeping only the newest
+        for(side=0; side<2; side++) {
+            while(exists[side]) {
+                MPI_Test(&recvs[side], &done, MPI_STATUS_IGNORE);
+                if(!done)
+                    break;
+                memcpy(halos[side], recvRows[side],
+                    (size_t)count * sizeof(double));
+                messages--;
+                black = true;
+                active = true;
+                MPI_Irecv(recvRows[side], count, MPI_DOUBLE, neighbours[side],
+                    4, planeComm, &recvs[side]);
+            }
+        }
+
+        if(active) {
+            relaxWavefront(plane, 1, last+1, sizeOfPlane, firstRow, kernel, 1,
+                1, &delta);
+            sweeps++;
+            active = tolerance < delta;
+            for(side=0; side<2; side++)
+                dirty[side] = dirty[side] || (active && exists[side]);
+        }
+
+        // Send the newest edge rows to any neighbour the last ones reached
+        for(side=0; side<2; side++) {
+            if(!exists[side] || !dirty[side])
+                continue;
+            MPI_Test(&sends[side], &done, MPI_STATUS_IGNORE);
+            if(!done)
+                continue;
+            memcpy(sendRows[side], edges[side], (size_t)count * sizeof(double));
+            MPI_Isend(sendRows[side], count, MPI_DOUBLE, neighbours[side], 4,
+                planeComm, &sends[side]);
+            messages++;
+            dirty[side] = false;
+        }
+
+        if(!holding && world_size > 1) {
+            MPI_Test(&recvs[2], &done, MPI_STATUS_IGNORE);
+            holding = done;
+        }
+        // The token only moves on from a process that is idle
+        if(holding && !active && !dirty[0] && !dirty[1]) {
+            if(world_size == 1) {
+                stopped = true;
+            } else if(world_rank == 0 && !firstRound && !tokenIn[1] &&
+                !black && tokenIn[0] + messages == 0)
+            {
+                // Everyone is idle and nothing is on the way, so all stop
+                for(int r=1; r<world_size; r++)
+                    MPI_Send(NULL, 0, MPI_INT, r, 6, planeComm);
+                stopped = true;
+            } else {
+                // The first process starts each round with a clean token
+                MPI_Wait(&sends[2], MPI_STATUS_IGNORE);
+                tokenOut[0] = world_rank == 0 ? 0 : tokenIn[0] + messages;
+                tokenOut[1] = world_rank == 0 ? 0 : tokenIn[1] || black;
+                MPI_Isend(tokenOut, 2, MPI_INT, (world_rank+1) % world_size,
+                    5, planeComm, &sends[2]);
+                MPI_Irecv(tokenIn, 2, MPI_INT,
+                    (world_rank+world_size-1) % world_size, 5,
+                    planeComm, &recvs[2]);
+                black = false;
+                holding = false;
+                firstRound = false;
+            }
+        }
+
+        if(world_rank > 0) {
+            MPI_Test(&recvs[3], &done, MPI_STATUS_IGNORE);
+            stopped = stopped || done;
+        }
+    }
+
+    /* Nothing is on the way once every process is idle, so the receives
+        still posted will never be matched */
+    for(int i=0; i<4; i++) {
+        if(recvs[i] != MPI_REQUEST_NULL) {
+            MPI_Cancel(&recvs[i]);
+            MPI_Wait(&recvs[i], MPI_STATUS_IGNORE);
+        }
+    }
+    MPI_Waitall(3, sends, MPI_STATUSES_IGNORE);
+    for(side=0; side<2; side++) {
+        free(sendRows[side]);
+        free(recvRows[side]);
+    }
+
+    // The processes each did their own number of sweeps
+    MPI_Allreduce(MPI_IN_PLACE, &sweeps, 1, MPI_UNSIGNED_LONG, MPI_MAX,
+        planeComm);
+    return sweeps;
+}
+
+/**
+ * @brief Performs the relaxation algorithm in true Gauss-Seidel order across
+ *         the processes, as if one process had the whole plane. Each process
+ *         starts a sweep as soon as the process above has finished its
+ *         bottom row for that sweep, so successive sweeps are in flight down
+ *         the processes at once. Only the row below the last needs the sweep
+ *         before from the process below, so that is waited on just before
+ *         the last row. The changes made by each sweep are reduced while the
+ *         next sweeps are done, and every process waits on each reduction
+ *         the same number of sweeps later, so they all stop together
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @return the number of iterations taken to perform the relaxation algorithm,
+ *          though the sweeps up to the reduction that found it are done
+ */
+unsigned long pipelinedRelaxPlane(double** plane, int numRows,
+    int sizeOfPlane, double tolerance, int world_rank, int world_size)
+{
+    int count = sizeOfPlane-2;
+    int last = numRows-2;
+    bool hasAbove = world_rank > 0;
+    bool hasBelow = world_rank < world_size-1;
+    /* The last process runs about a sweep behind each process above it, so
+        waiting any sooner than this would hold the first ones up */
+    int lag = world_size + 1;
+    MPI_Request* reductions = ( MPI_Request* )malloc((size_t)lag
+        * sizeof(MPI_Request));
+    double* sweepDelta = ( double* )malloc((size_t)lag * sizeof(double));
+    MPI_Request sends[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    unsigned long t, iterations = 0;
+    int slot;
+    double delta, maxDelta;
+
+    for(t=0; ; t++) {
+        slot = (int)(t % (unsigned long)lag);
+        if(t >= (unsigned long)lag) {
+            MPI_Wait(&reductions[slot], MPI_STATUS_IGNORE);
+            if(!(tolerance < sweepDelta[slot])) {
+                iterations = t - (unsigned long)lag + 1;
+                break;
+            }
+        }
+
+        // The bottom row of the process above, from this same sweep
+        if(hasAbove)
+            MPI_Recv(&plane[0][1], count, MPI_DOUBLE, world_rank-1, 0,
+                planeComm, MPI_STATUS_IGNORE);
+
+        maxDelta = 0;
+        for(int i=1; i<=last; i++) {
+            // The top row of the process below, from the sweep before
+            if(i == last && hasBelow && t > 0)
+                MPI_Recv(&plane[last+1][1], count, MPI_DOUBLE, world_rank+1,
+                    0, planeComm, MPI_STATUS_IGNORE);
+            // An edge row is only changed once the last one sent has gone
+            if(i == 1)
+                MPI_Wait(&sends[0], MPI_STATUS_IGNORE);
+            if(i == last)
+                MPI_Wait(&sends[1], MPI_STATUS_IGNORE);
+            delta = relaxRowGS(plane[i-1], plane[i], plane[i+1], 1,
+                sizeOfPlane-1, 1);
+            maxDelta = delta > maxDelta ? delta : maxDelta;
+            // The process above needs this for the end of its next sweep
+            if(i == 1 && hasAbove)
+                MPI_Isend(&plane[1][1], count, MPI_DOUBLE, world_rank-1, 0,
+                    planeComm, &sends[0]);
+        }
+        if(hasBelow)
+            MPI_Isend(&plane[last][1], count, MPI_DOUBLE, world_rank+1, 0,
+                planeComm, &sends[1]);
+
+        sweepDelta[slot] = maxDelta;
+        MPI_Iallreduce(MPI_IN_PLACE, &sweepDelta[slot], 1, MPI_DOUBLE,
+            MPI_MAX, planeComm, &reductions[slot]);
+    }
+
+    /* The top row of the process below from the last sweep is still on its
+        way, and the reductions since the one that was found are unused */
+    if(hasBelow && t > 0)
+        MPI_Recv(&plane[last+1][1], count, MPI_DOUBLE, world_rank+1, 0,
+            planeComm, MPI_STATUS_IGNORE);
+    MPI_Waitall(2, sends, MPI_STATUSES_IGNORE);
+    for(int i=0; i<lag; i++)
+        if(i != slot)
+            MPI_Wait(&reductions[i], MPI_STATUS_IGNORE);
+    free(reductions);
+    free(sweepDelta);
+    return iterations;
+}
+
+/**
+ * @brief Performs the relaxation algorithm with red-black ordering, holding
+ *         enough rows from the processes above and below this one to do
+ *         several sweeps between swaps. The rows held from other processes are
+ *         relaxed here as well, which gives them the same values as the
+ *         process they belong to, until they are used up
+ * @param plane pointer to the 2D array, holding 2*sweeps rows from each of
+ *         the processes above and below this one
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved red-black kernel used to relax each row
+ * @param sweeps number of sweeps to do between each swap
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @return the number of iterations taken to perform the relaxation algorithm.
+ *          This is the first sweep that converged on every process, though
+ *          the rest of the sweeps before the next swap are done
+ */
+unsigned long relaxPlaneDeep(double** plane, int numRows, int sizeOfPlane,
+    double tolerance, int world_rank, int world_size, int firstRow,
+    Kernel kernel, int sweeps, OmegaEstimate* omega)
+{
+    unsigned long iterations = 0;
+    int step, i, lo, hi;
+    // Relaxing a colour uses up one of the rows held from each neighbour
+    int halo = 2 * sweeps;
+    // The edges of the plane are one fixed row rather than a neighbour's rows
+    int top = world_rank > 0 ? halo : 1;
+    int bottom = world_rank < world_size-1 ? halo : 1;
+    int stride = (int)(plane[1]-plane[0]);
+    double delta;
+    RowKernel relaxRow = rowKernel(kernel, omega->over);
+    double* sweepDelta = ( double* )malloc((size_t)sweeps * sizeof(double));
+
+    while(1) {
+        // The rows are one block of memory, so all of them go in one message
+        exchangeRows(plane[top], plane[0], plane[numRows-bottom-halo],
+            plane[numRows-halo], halo * stride, MPI_DOUBLE, world_rank,
+            world_size);
+
+        for(i=0; i<sweeps; i++)
+            sweepDelta[i] = 0;
+        /* Each colour leaves the outermost row held from a neighbour out of
+            date, so one fewer of them is relaxed for the next colour */
+        for(step=0; step<halo; step++) {
+            lo = world_rank > 0 ? 1 + step : 1;
+            hi = world_rank < world_size-1 ? numRows-1-step : numRows-1;
+            for(i=lo; i<hi; i++) {
+                delta = relaxRow(plane[i-1], plane[i], plane[i+1],
+                    colourStart(firstRow+i, step%2), sizeOfPlane-1,
+                    omega->omega);
+                // Only this process's own rows count towards convergence
+                if(i >= top && i < numRows-bottom &&
+                    delta > sweepDelta[step/2])
+                    sweepDelta[step/2] = delta;
+            }
+        }
+
+        MPI_Allreduce(MPI_IN_PLACE, sweepDelta, sweeps, MPI_DOUBLE, MPI_MAX,
+            planeComm);
+        for(i=0; i<sweeps; i++) {
+            iterations++;
+            if(!(tolerance < sweepDelta[i])) {
+                free(sweepDelta);
+                return iterations;
+            }
+            updateOmega(omega, sweepDelta[i]);
+        }
+    }
+}
+
+/**
+ * @brief Performs the relaxation algorithm in mixed precision. This process's
+ *         part of the plane is relaxed as floats, with the edge rows swapped
+ *         as floats, which halves the memory traffic of each sweep and the
+ *         size of each message. Once it converges or the changes stop
+ *         shrinking, it is relaxed as doubles until it converges
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved kernel used to relax each row
+ * @param checkInterval number of sweeps between convergence checks once it
+ *         is relaxed as doubles, or CHECK_ADAPTIVE
+ * @param lagged whether to hide the reductions once it is relaxed as doubles
+ * @param haloMode how the edge rows are swapped once it is relaxed as doubles
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @return the number of iterations taken, as floats and doubles together
+ */
+unsigned long mixedRelaxPlane(double** plane, int numRows, int sizeOfPlane,
+    double tolerance, int world_rank, int world_size, int firstRow,
+    Kernel kernel, int checkInterval, bool lagged, HaloMode haloMode,
+    OmegaEstimate* omega)
+{
+    unsigned long iterations = 0;
+    int i, colour;
+    int n = sizeOfPlane;
+    int sinceSmallest = 0;
+    float delta, stall = 0;
+    double maxDelta, smallest = DBL_MAX;
+    FloatRowKernel relaxRow = floatRowKernel(kernel, omega->over);
+    float** floats = newFloatSubPlane((unsigned int)n, (unsigned int)numRows);
+    MPI_Request halos[4] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL,
+        MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+
+    for(i=0; i<numRows; i++) {
+        for(int j=0; j<n; j++) {
+            floats[i][j] = (float)plane[i][j];
+            stall = fabsf(floats[i][j]) > stall ? fabsf(floats[i][j]) : stall;
+        }
+    }
+    // The largest cell is on an edge, so it sets the rounding of every cell
+    MPI_Allreduce(MPI_IN_PLACE, &stall, 1, MPI_FLOAT, MPI_MAX,
+        planeComm);
+    stall *= MIXED_STALL * FLT_EPSILON;
+
+    do {
+        maxDelta = 0;
+        iterations++;
+
+        if(kernel == KERNEL_GS) {
+            for(i=1; i<numRows-1; i++) {
+                delta = relaxRow(floats[i-1], floats[i], floats[i+1], 1, n-1,
+                    (float)omega->omega);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
+            }
+            exchangeHalosFloat(floats, numRows, n, world_rank, world_size);
+        } else {
+            for(colour=0; colour<2; colour++) {
+                MPI_Waitall(4, halos, MPI_STATUSES_IGNORE);
+                delta = relaxColourOverlappedFloat(floats, numRows, n,
+                    world_rank, world_size, firstRow, colour, relaxRow,
+                    (float)omega->omega, halos);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &maxDelta, 1, MPI_DOUBLE, MPI_MAX,
+            planeComm);
+        updateOmega(omega, maxDelta);
+
+        if(maxDelta < smallest) {
+            smallest = maxDelta;
+            sinceSmallest = 0;
+        } else {
+            sinceSmallest++;
+        }
+    } while(tolerance < maxDelta && stall < maxDelta &&
+        sinceSmallest < MIXED_PATIENCE);
+    MPI_Waitall(4, halos, MPI_STATUSES_IGNORE);
+
+    for(i=1; i<numRows-1; i++)
+        for(int j=1; j<n-1; j++)
+            plane[i][j] = floats[i][j];
+    exchangeHalos(plane, numRows, n, world_rank, world_size);
+    free(floats[0]);
+    free(floats);
+
+    return iterations + relaxPlane(plane, numRows, sizeOfPlane, tolerance,
+        world_rank, world_size, firstRow, kernel, 1, checkInterval, lagged,
+        haloMode, omega, NULL, false);
+}
+
+/**
+ * @brief Splits the inner cells along one side of the plane as evenly as
+ *         possible, with the first parts getting any extra
+ * @param inner number of inner cells along the side
+ * @param parts number of parts to split them into
+ * @param index which part to get
+ * @param count set to the number of cells in the part
+ * @param first set to the index in the whole plane of the edge cell before
+ *         the part
+ */
+void splitCells(int inner, int parts, int index, int* count, int* first) {
+    int each = inner/parts;
+    int extra = inner - parts * each;
+
+    *count = each + (index < extra ? 1 : 0);
+    *first = index * each + (index < extra ? index : extra);
+}
+
+/**
+ * @brief Splits the plane into a 2D grid of blocks with MPI_Dims_create, and
+ *         gets this process's block from MPI_Cart_create
+ * @param sizeOfPlane number of rows and length of each row in the plane
+ * @param world_size number of MPI_processes
+ * @return this process's block, with a comm of MPI_COMM_NULL if the plane is
+ *          too small to give every process a block
+ */
+CartBlock newCartBlock(int sizeOfPlane, int world_size) {
+    CartBlock block;
+    int periods[2] = {0, 0};
+    int coords[2];
+    int count;
+
+    block.dims[0] = 0;
+    block.dims[1] = 0;
+    MPI_Dims_create(world_size, 2, block.dims);
+    if(block.dims[0] > sizeOfPlane-2 || block.dims[1] > sizeOfPlane-2) {
+        block.comm = MPI_COMM_NULL;
+        return block;
+    }
+
+    // MPI may renumber the processes so neighbouring blocks are close by
+    MPI_Cart_create(planeComm, 2, block.dims, periods, 1, &block.comm);
+    MPI_Comm_rank(block.comm, &block.rank);
+    MPI_Cart_coords(block.comm, block.rank, 2, coords);
+    // Blocks on the edge of the plane get MPI_PROC_NULL, so swaps are no-ops
+    MPI_Cart_shift(block.comm, 0, 1, &block.up, &block.down);
+    MPI_Cart_shift(block.comm, 1, 1, &block.left, &block.right);
+
+    splitCells(sizeOfPlane-2, block.dims[0], coords[0], &count,
+        &block.firstRow);
+    block.numRows = count + 2;
+    splitCells(sizeOfPlane-2, block.dims[1], coords[1], &count,
+        &block.firstCol);
+    block.numCols = count + 2;
+    return block;
+}
+
+/**
+ * @brief Populates a block's cells that are on the walls of the plane with
+ *         the values provided, and sets the rest to zero. The corners take the
+ *         same values as populateSubPlane gives them
+ * @param plane pointer to the block's 2D array
+ * @param numRows number of rows in the array
+ * @param numCols length of each row in the array
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param firstCol index in the whole plane of the first column in the array
+ * @param sizeOfPlane number of rows and length of each row in the plane
+ * @param top value to put in top edge of the plane
+ * @param bottom value to put in bottom edge of the plane
+ * @param farLeft value to put in left edge of the plane
+ * @param farRight value to put in right edge of the plane
+ */
+void populateBlock(double** plane, int numRows, int numCols, int firstRow,
+    int firstCol, int sizeOfPlane, double top, double bottom, double farLeft,
+    double farRight)
+{
+    int row, col;
+
+    for(int i=0; i<numRows; i++) {
+        row = firstRow + i;
+        for(int j=0; j<numCols; j++) {
+            col = firstCol + j;
+            if(col == 0)
+                plane[i][j] = farLeft;
+            else if(row == 0)
+                plane[i][j] = top;
+            else if(col == sizeOfPlane-1)
+                plane[i][j] = farRight;
+            else if(row == sizeOfPlane-1)
+                plane[i][j] = bottom;
+            else
+                plane[i][j] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Swaps the edge rows and columns of this process's block with the
+ *         blocks around it
+ * @param plane pointer to the block's 2D array
+ * @param block this process's block
+ * @param column datatype of one column of the block's inner cells
+ */
+void exchangeBlockHalos(double** plane, const CartBlock* block,
+    MPI_Datatype column)
+{
+    int last = block->numRows-2;
+    int lastCol = block->numCols-2;
+    MPI_Request requests[8];
+
+    MPI_Irecv(&plane[0][1], lastCol, MPI_DOUBLE, block->up, 0, block->comm,
+        &requests[0]);
+    MPI_Irecv(&plane[last+1][1], lastCol, MPI_DOUBLE, block->down, 0,
+        block->comm, &requests[1]);
+    MPI_Irecv(&plane[1][0], 1, column, block->left, 0, block->comm,
+        &requests[2]);
+    MPI_Irecv(&plane[1][lastCol+1], 1, column, block->right, 0, block->comm,
+        &requests[3]);
+    MPI_Isend(&plane[1][1], lastCol, MPI_DOUBLE, block->up, 0, block->comm,
+        &requests[4]);
+    MPI_Isend(&plane[last][1], lastCol, MPI_DOUBLE, block->down, 0,
+        block->comm, &requests[5]);
+    MPI_Isend(&plane[1][1], 1, column, block->left, 0, block->comm,
+        &requests[6]);
+    MPI_Isend(&plane[1][lastCol], 1, column, block->right, 0, block->comm,
+        &requests[7]);
+    MPI_Waitall(8, requests, MPI_STATUSES_IGNORE);
+}
+
+/**
+ * @brief Performs the relaxation algorithm on this process's block of the
+ *         plane. The edge rows and columns are swapped after each colour, so
+ *         with red-black ordering every process sees the same values it
+ *         would if it had the whole plane
+ * @param plane pointer to the block's 2D array
+ * @param block this process's block
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param kernel resolved kernel used to relax each row
+ * @param checkInterval number of sweeps between convergence checks, or
+ *         CHECK_ADAPTIVE
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @return the number of iterations taken to perform the relaxation algorithm.
+ *          With more than one sweep per check only the last sweep before the
+ *          check finds its changes, unless omega is being estimated
+ */
+unsigned long relaxBlockPlane(double** plane, const CartBlock* block,
+    double tolerance, Kernel kernel, int checkInterval, OmegaEstimate* omega)
+{
+    unsigned long iterations = 0;
+    int i, p, colour, sweeps, unchecked, start;
+    int last = block->numRows-1;
+    int end = block->numCols-1;
+    double delta, maxDelta;
+    RowKernel relaxRow = rowKernel(kernel, omega->over);
+    UncheckedRowKernel uncheckedRow = uncheckedRowKernel(kernel, omega->over);
+    CheckSchedule schedule = newCheckSchedule(checkInterval);
+    double* sweepDelta = ( double* )malloc((size_t)maxCheckInterval(&schedule)
+        * sizeof(double));
+    MPI_Datatype column;
+
+    // A column of inner cells, one from each row of the array
+    MPI_Type_vector(block->numRows-2, 1, (int)(plane[1]-plane[0]), MPI_DOUBLE,
+        &column);
+    MPI_Type_commit(&column);
+
+    while(1) {
+        sweeps = schedule.interval;
+        // Estimating omega needs every sweep's change, not just the last
+        unchecked = omega->estimating ? 0 : sweeps-1;
+
+        for(p=0; p<sweeps; p++) {
+            // Sweeps that are not checked can never be the one that converged
+            maxDelta = p < unchecked ? HUGE_VAL : 0;
+            if(kernel == KERNEL_GS) {
+                for(i=1; i<last; i++) {
+                    if(p < unchecked) {
+                        uncheckedRow(plane[i-1], plane[i], plane[i+1], 1, end,
+                            omega->omega);
+                        continue;
+                    }
+                    delta = relaxRow(plane[i-1], plane[i], plane[i+1], 1, end,
+                        omega->omega);
+                    maxDelta = delta > maxDelta ? delta : maxDelta;
+                }
+                exchangeBlockHalos(plane, block, column);
+            } else {
+                /* A cell's colour is the parity of its row and column in the
+                    whole plane, so the column offset is added to the row */
+                for(colour=0; colour<2; colour++) {
+                    for(i=1; i<last; i++) {
+                        start = colourStart(block->firstRow+block->firstCol+i,
+                            colour);
+                        if(p < unchecked) {
+                            uncheckedRow(plane[i-1], plane[i], plane[i+1],
+                                start, end, omega->omega);
+                            continue;
+                        }
+                        delta = relaxRow(plane[i-1], plane[i], plane[i+1],
+                            start, end, omega->omega);
+                        maxDelta = delta > maxDelta ? delta : maxDelta;
+                    }
+                    exchangeBlockHalos(plane, block, column);
+                }
+            }
+            sweepDelta[p] = maxDelta;
+        }
+
+        MPI_Allreduce(MPI_IN_PLACE, sweepDelta, sweeps, MPI_DOUBLE, MPI_MAX,
+            block->comm);
+        if(checkSweeps(sweepDelta, sweeps, tolerance, &iterations, omega,
+            &schedule))
+            break;
+    }
+
+    MPI_Type_free(&column);
+    free(sweepDelta);
+    return iterations;
+}
+
+/**
+ * @brief Collects every process's block into the whole plane on the process
+ *         with rank 0 in the block's comm, for writing out
+ * @param plane pointer to the block's 2D array
+ * @param block this process's block
+ * @param whole the whole plane, with its edges populated, on rank 0 only
+ * @param sizeOfPlane number of rows and length of each row in the plane
+ */
+void gatherBlocks(double** plane, const CartBlock* block, double** whole,
+    int sizeOfPlane)
+{
+    int sizes[2], subsizes[2], starts[2], coords[2];
+    int size, rows, cols, firstRow, firstCol;
+    MPI_Datatype inner;
+
+    if(block->rank != 0) {
+        // This block's inner cells, out of the array with its stride
+        sizes[0] = block->numRows;
+        sizes[1] = (int)(plane[1]-plane[0]);
+        subsizes[0] = block->numRows-2;
+        subsizes[1] = block->numCols-2;
+        starts[0] = 1;
+        starts[1] = 1;
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+            MPI_DOUBLE, &inner);
+        MPI_Type_commit(&inner);
+        MPI_Send(&plane[0][0], 1, inner, 0, 1, block->comm);
+        MPI_Type_free(&inner);
+        return;
+    }
+
+    MPI_Comm_size(block->comm, &size);
+    for(int r=0; r<size; r++) {
+        MPI_Cart_coords(block->comm, r, 2, coords);
+        splitCells(sizeOfPlane-2, block->dims[0], coords[0], &rows, &firstRow);
+        splitCells(sizeOfPlane-2, block->dims[1], coords[1], &cols, &firstCol);
+        if(r == 0) {
+            for(int i=1; i<=rows; i++)
+                memcpy(&whole[firstRow+i][firstCol+1], &plane[i][1],
+                    (size_t)cols * sizeof(double));
+            continue;
+        }
+        // Where the block goes in the whole plane
+        sizes[0] = sizeOfPlane;
+        sizes[1] = (int)(whole[1]-whole[0]);
+        subsizes[0] = rows;
+        subsizes[1] = cols;
+        starts[0] = firstRow+1;
+        starts[1] = firstCol+1;
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+            MPI_DOUBLE, &inner);
+        MPI_Type_commit(&inner);
+        MPI_Recv(&whole[0][0], 1, inner, r, 1, block->comm,
+            MPI_STATUS_IGNORE);
+        MPI_Type_free(&inner);
+    }
+}
+
+/**
+ * @brief Performs Jacobi iteration on this process's part of the plane. Each
+ *         iteration is written into a second array, then the two arrays are
+ *         swapped. As every process swaps its edge rows after every
+ *         iteration, the result is the same for any number of processes
+ * @param plane pointer to the 2D array, which holds the result at the end
+ * @param next second 2D array, with the same edges as plane
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to perform the iteration to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param kernel resolved kernel, whose instruction set is used
+ * @return the number of iterations taken
+ */
+unsigned long jacobiPlane(double** plane, double** next, int numRows,
+    int sizeOfPlane, double tolerance, int world_rank, int world_size,
+    Kernel kernel)
+{
+    unsigned long iterations = 0;
+    int endFlag;
+    double delta, maxDelta;
+    double** current = plane;
+    double** swap;
+    JacobiRowKernel jacobiRowFn = jacobiKernel(kernel);
+    bool stream = shouldStream(2 * (size_t)numRows * (size_t)sizeOfPlane
+        * sizeof(double));
+
+    do {
+        maxDelta = 0;
+        iterations++;
+
+        for(int i=1; i<numRows-1; i++) {
+            delta = jacobiRowFn(current[i-1], current[i], current[i+1],
+                next[i], 1, sizeOfPlane-1, stream);
+            maxDelta = delta > maxDelta ? delta : maxDelta;
+        }
+#ifdef HAVE_X86_SIMD
+        // Make sure the non-temporal stores are done before they are sent
+        if(stream)
+            _mm_sfence();
+#endif
+        exchangeHalos(next, numRows, sizeOfPlane, world_rank, world_size);
+
+        swap = current;
+        current = next;
+        next = swap;
+
+        endFlag = !(tolerance < maxDelta);
+        MPI_Allreduce(MPI_IN_PLACE, &endFlag, 1, MPI_INT, MPI_LAND,
+            planeComm);
+    } while(!endFlag);
+
+    // The result ends up in whichever array was written last
+    if(current != plane)
+        for(int i=0; i<numRows; i++)
+            memcpy(&plane[i][1], &current[i][1],
+                (size_t)(sizeOfPlane-2) * sizeof(double));
+
+    return iterations;
+}
+
+/**
+ * @brief Performs one Chebyshev step on every cell of a row. Each new value is
+ *         the Jacobi update over-relaxed against the value from the iteration
+ *         before last, which is read from and replaced in out
+ * @param above row above the one being relaxed, from the current iteration
+ * @param row row being relaxed, from the current iteration
+ * @param below row below the one being relaxed, from the current iteration
+ * @param out row from the iteration before last, to write the new row into
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param omega the Chebyshev weight for this iteration
+ * @param check true to find the largest change made to any cell
+ * @return the largest absolute change made to any cell, or 0 if not checked
+ */
+double chebyshevRow(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    double omega, bool check)
+{
+    double delta, maxDelta = 0;
+
+    // Iterations that are not checked leave out the change entirely
+    if(!check) {
+        for(int j=start; j<end; j++)
+            out[j] += omega * ((above[j] + below[j] + row[j-1] + row[j+1])/4
+                - out[j]);
+        return 0;
+    }
+    for(int j=start; j<end; j++) {
+        out[j] += omega * ((above[j] + below[j] + row[j-1] + row[j+1])/4
+            - out[j]);
+        delta = fabs(out[j] - row[j]);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Performs Chebyshev accelerated Jacobi iteration on this process's
+ *         part of the plane. The weights come from the spectral radius of
+ *         Jacobi iteration on a grid of this size, so nothing has to be
+ *         measured while it runs. Edge rows are swapped after every
+ *         iteration, but the change is only found and reduced over the
+ *         processes every checkInterval iterations
+ * @param plane pointer to the 2D array, which holds the result at the end
+ * @param next second 2D array, with the same edges and cells as plane
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to perform the iteration to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param checkInterval number of iterations between convergence checks, or
+ *         CHECK_ADAPTIVE
+ * @return the number of iterations taken
+ */
+unsigned long chebyshevPlane(double** plane, double** next, int numRows,
+    int sizeOfPlane, double tolerance, int world_rank, int world_size,
+    int checkInterval)
+{
+    unsigned long iterations = 0;
+    double rho = cos(M_PI/(double)(sizeOfPlane-1));
+    double omega = 1;
+    double delta, maxDelta;
+    bool check;
+    int sinceCheck = 0;
+    CheckSchedule schedule = newCheckSchedule(checkInterval);
+    double** current = plane;
+    double** swap;
+
+    do {
+        maxDelta = 0;
+        iterations++;
+        check = ++sinceCheck == schedule.interval;
+
+        for(int i=1; i<numRows-1; i++) {
+            delta = chebyshevRow(current[i-1], current[i], current[i+1],
+                next[i], 1, sizeOfPlane-1, omega, check);
+            maxDelta = delta > maxDelta ? delta : maxDelta;
+        }
+        exchangeHalos(next, numRows, sizeOfPlane, world_rank, world_size);
+
+        swap = current;
+        current = next;
+        next = swap;
+
+        /* The first iteration is plain Jacobi, then the weights approach
+            their limit of the optimal over-relaxation factor */
+        omega = iterations == 1 ? 1/(1 - rho*rho/2)
+            : 1/(1 - rho*rho*omega/4);
+
+        /* The largest change over all of the processes both says whether
+            they have finished and how quickly they are converging */
+        if(check) {
+            MPI_Allreduce(MPI_IN_PLACE, &maxDelta, 1, MPI_DOUBLE, MPI_MAX,
+                planeComm);
+            nextCheck(&schedule, maxDelta, sinceCheck, tolerance);
+            sinceCheck = 0;
+        }
+    } while(!check || tolerance < maxDelta);
+
+    // The result ends up in whichever array was written last
+    if(current != plane)
+        for(int i=0; i<numRows; i++)
+            memcpy(&plane[i][1], &current[i][1],
+                (size_t)(sizeOfPlane-2) * sizeof(double));
+
+    return iterations;
+}
+
+/**
+ * @brief Sets every cell of a 2D array to zero
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param n length of each row in the array
+ */
+void clearPlane(double** plane, int numRows, int n) {
+    for(int i=0; i<numRows; i++)
+        memset(plane[i], 0, (size_t)n * sizeof(double));
+}
+
+/**
+ * @brief Gets the number of rows and columns of the next coarser grid
+ * @param n number of rows and columns of the finer grid
+ * @return number of rows and columns of the coarser grid
+ */
+int coarseSize(int n) {
+    return n/2 + 1;
+}
+
+/**
+ * @brief Gets the index on the finer grid of a row or column of the coarser
+ *         grid. Every other index is kept, apart from the last which is always
+ *         the edge of the plane, so grids of any size can be coarsened
+ * @param i index on the coarser grid
+ * @param coarseN number of rows and columns of the coarser grid
+ * @param fineN number of rows and columns of the finer grid
+ * @return index on the finer grid
+ */
+int fineIndex(int i, int coarseN, int fineN) {
+    return i == coarseN-1 ? fineN-1 : 2*i;
+}
+
+/**
+ * @brief Gets the index in the plane of a row or column of a level
+ * @param mg the multigrid hierarchy
+ * @param l the level the index is on
+ * @param i index on the level
+ * @return index in the plane
+ */
+int planeIndex(const Multigrid* mg, int l, int i) {
+    for(int k=l; k>0; k--)
+        i = fineIndex(i, mg->levels[k].n, mg->levels[k-1].n);
+    return i;
+}
+
+/**
+ * @brief Allocates the arrays of a level, with the residual's edges cleared
+ * @param level the level, with its size and rows already set
+ */
+void allocLevel(MultigridLevel* level) {
+    level->u = newSubPlane((unsigned int)level->n,
+        (unsigned int)level->numRows);
+    level->rhs = newSubPlane((unsigned int)level->n,
+        (unsigned int)level->numRows);
+    level->res = newSubPlane((unsigned int)level->n,
+        (unsigned int)level->numRows);
+    clearPlane(level->res, level->numRows, level->n);
+}
+
+/**
+ * @brief Frees the arrays of a level
+ * @param level the level
+ */
+void freeLevel(MultigridLevel* level) {
+    freePlane(level->u);
+    freePlane(level->rhs);
+    freePlane(level->res);
+}
+
+/**
+ * @brief Relaxes every other cell of a row for a level with a right hand side,
+ *         i.e. the cells of one colour for red-black ordering
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param rhs right hand side of the row, scaled by the grid spacing squared
+ * @param start first column of this colour to relax
+ * @param end column after the last one to relax
+ */
+void smoothRow(const double* restrict above, double* restrict row,
+    const double* restrict below, const double* restrict rhs, int start,
+    int end)
+{
+    for(int j=start; j<end; j+=2)
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1] + rhs[j])/4;
+}
+
+/**
+ * @brief Applies red-black sweeps to a level, swapping edge rows after each
+ *         colour if it is split. The finest level has no right hand side, so
+ *         it is relaxed with the chosen kernel
+ * @param mg the multigrid hierarchy
+ * @param level the level to smooth
+ * @param sweeps number of sweeps to apply
+ */
+void smoothLevel(const Multigrid* mg, MultigridLevel* level, int sweeps) {
+    double** u = level->u;
+    int n = level->n;
+    int start;
+
+    for(int s=0; s<sweeps; s++) {
+        for(int colour=0; colour<2; colour++) {
+            for(int i=1; i<level->numRows-1; i++) {
+                start = colourStart(level->firstRow+i, colour);
+                if(level->rhs)
+                    smoothRow(u[i-1], u[i], u[i+1], level->rhs[i], start,
+                        n-1);
+                else
+                    mg->relaxRow(u[i-1], u[i], u[i+1], start, n-1, 1);
+            }
+            if(level->distributed)
+                exchangeHalos(u, level->numRows, n, mg->world_rank,
+                    mg->world_size);
+        }
+    }
+}
+
+/**
+ * @brief Calculates the residual of every cell in a level, scaled by the grid
+ *         spacing squared, and swaps the edge rows of it if the level is split
+ * @param mg the multigrid hierarchy
+ * @param level the level to calculate the residual of
+ */
+void residualLevel(const Multigrid* mg, MultigridLevel* level) {
+    double** u = level->u;
+    int n = level->n;
+
+    for(int i=1; i<level->numRows-1; i++) {
+        for(int j=1; j<n-1; j++) {
+            level->res[i][j] = (level->rhs ? level->rhs[i][j] : 0)
+                + u[i-1][j] + u[i+1][j] + u[i][j-1] + u[i][j+1] - 4*u[i][j];
+        }
+    }
+    if(level->distributed)
+        exchangeHalos(level->res, level->numRows, n, mg->world_rank,
+            mg->world_size);
+}
+
+/**
+ * @brief Restricts the residual of a level to the right hand side of the next
+ *         coarser level with full weighting, and clears the coarser level's
+ *         correction. The right hand side is scaled by the coarser grid's
+ *         spacing squared, which is four times the finer grid's
+ * @param fine the finer level, with its residual calculated
+ * @param coarse the coarser level
+ */
+void restrictLevel(const MultigridLevel* fine, MultigridLevel* coarse) {
+    double** r = fine->res;
+    int i, j;
+
+    clearPlane(coarse->u, coarse->numRows, coarse->n);
+    for(int ci=1; ci<coarse->numRows-1; ci++) {
+        i = 2*(coarse->firstRow+ci) - fine->firstRow;
+        for(int cj=1; cj<coarse->n-1; cj++) {
+            j = 2*cj;
+            coarse->rhs[ci][cj] = r[i][j]
+                + (r[i-1][j] + r[i+1][j] + r[i][j-1] + r[i][j+1])/2
+                + (r[i-1][j-1] + r[i-1][j+1] + r[i+1][j-1] + r[i+1][j+1])/4;
+        }
+    }
+}
+
+/**
+ * @brief Bilinearly interpolates a coarser level onto the cells of a finer
+ *         level, either adding it as a correction or replacing them. The
+ *         coarser level must hold the rows either side of the finer level's
+ * @param coarse the coarser level
+ * @param fine the finer level
+ * @param add true to add to the finer level, false to overwrite it
+ */
+void prolongLevel(const MultigridLevel* coarse, MultigridLevel* fine,
+    bool add)
+{
+    double** c = coarse->u;
+    double val;
+    int row, i0, i1, j0, j1;
+
+    for(int i=1; i<fine->numRows-1; i++) {
+        // Even rows sit on a coarse row, odd rows between two of them
+        row = fine->firstRow + i;
+        i0 = row/2 - coarse->firstRow;
+        i1 = (row+1)/2 - coarse->firstRow;
+        for(int j=1; j<fine->n-1; j++) {
+            j0 = j/2;
+            j1 = (j+1)/2;
+            val = (c[i0][j0] + c[i0][j1] + c[i1][j0] + c[i1][j1])/4;
+            fine->u[i][j] = add ? fine->u[i][j] + val : val;
+        }
+    }
+}
+
+/**
+ * @brief Clears a level and copies the edges of the plane onto its edges, so
+ *         the level can solve the plane itself
+ * @param mg the multigrid hierarchy
+ * @param level the level, or the rows of it held by this process
+ * @param l the index of the level
+ */
+void injectEdges(const Multigrid* mg, MultigridLevel* level, int l) {
+    int n = level->n;
+    int row;
+    const double* edge;
+
+    clearPlane(level->u, level->numRows, n);
+    clearPlane(level->rhs, level->numRows, n);
+    for(int i=0; i<level->numRows; i++) {
+        row = level->firstRow + i;
+        if(row == 0 || row == n-1) {
+            edge = row == 0 ? mg->top : mg->bottom;
+            for(int j=0; j<n; j++)
+                level->u[i][j] = edge[planeIndex(mg, l, j)];
+        } else {
+            level->u[i][0] = mg->left[planeIndex(mg, l, row)];
+            level->u[i][n-1] = mg->right[planeIndex(mg, l, row)];
+        }
+    }
+}
+
+/**
+ * @brief Gathers the right hand side of the rows of the agglomerated level
+ *         owned by each process onto process 0
+ * @param mg the multigrid hierarchy
+ */
+void gatherLevel(Multigrid* mg) {
+    MultigridLevel* slab = &mg->slab;
+    int stride = (int)(slab->rhs[1] - slab->rhs[0]);
+    double* whole = mg->world_rank == 0 ?
+        mg->levels[mg->agglomerate].rhs[0] : NULL;
+
+    MPI_Gatherv(slab->rhs[1], (slab->numRows-2) * stride, MPI_DOUBLE,
+        whole, mg->counts, mg->displs, MPI_DOUBLE, 0, planeComm);
+}
+
+/**
+ * @brief Sends the rows of the agglomerated level's correction that each
+ *         process holds, including its edge rows, from process 0
+ * @param mg the multigrid hierarchy
+ */
+void scatterLevel(Multigrid* mg) {
+    MultigridLevel* slab = &mg->slab;
+    int stride = (int)(slab->u[1] - slab->u[0]);
+    double** whole;
+    MPI_Request* requests;
+
+    if(mg->world_rank != 0) {
+        MPI_Recv(slab->u[0], slab->numRows * stride, MPI_DOUBLE, 0, 1,
+            planeComm, MPI_STATUS_IGNORE);
+        return;
+    }
+
+    // Neighbouring processes share edge rows, so each is sent on its own
+    whole = mg->levels[mg->agglomerate].u;
+    requests = ( MPI_Request* )malloc((size_t)mg->world_size
+        * sizeof(MPI_Request));
+    for(int r=1; r<mg->world_size; r++)
+        MPI_Isend(whole[mg->slabFirst[r]], mg->slabRows[r] * stride,
+            MPI_DOUBLE, r, 1, planeComm, &requests[r-1]);
+    memcpy(slab->u[0], whole[0], (size_t)(slab->numRows * stride)
+        * sizeof(double));
+    MPI_Waitall(mg->world_size-1, requests, MPI_STATUSES_IGNORE);
+    free(requests);
+}
+
+/**
+ * @brief Performs a V-cycle from a level down to the coarsest level and back.
+ *         The levels that are held whole are only visited by process 0
+ * @param mg the multigrid hierarchy
+ * @param l the level to start from
+ */
+void vCycle(Multigrid* mg, int l) {
+    MultigridLevel* level = &mg->levels[l];
+    MultigridLevel* coarse;
+
+    if(l == mg->numLevels-1) {
+        smoothLevel(mg, level, MG_COARSE_SWEEPS);
+        return;
+    }
+    smoothLevel(mg, level, MG_SMOOTH);
+    residualLevel(mg, level);
+
+    if(level->distributed && l+1 == mg->agglomerate) {
+        // Solve the coarser levels on process 0, then share the correction
+        coarse = &mg->slab;
+        restrictLevel(level, coarse);
+        gatherLevel(mg);
+        if(mg->world_rank == 0) {
+            clearPlane(mg->levels[l+1].u, mg->levels[l+1].n,
+                mg->levels[l+1].n);
+            vCycle(mg, l+1);
+        }
+        scatterLevel(mg);
+    } else {
+        coarse = &mg->levels[l+1];
+        restrictLevel(level, coarse);
+        vCycle(mg, l+1);
+    }
+
+    prolongLevel(coarse, level, true);
+    if(level->distributed)
+        exchangeHalos(level->u, level->numRows, level->n, mg->world_rank,
+            mg->world_size);
+    smoothLevel(mg, level, MG_SMOOTH);
+}
+
+/**
+ * @brief Performs a full multigrid cycle. The plane is solved on the coarsest
+ *         level first, then each solution is interpolated onto the next finer
+ *         level as its starting point and improved with a V-cycle
+ * @param mg the multigrid hierarchy
+ */
+void fullMultigrid(Multigrid* mg) {
+    int a = mg->agglomerate;
+    MultigridLevel* coarse;
+    int l;
+
+    // Coarser levels solve the plane itself, with their own copy of the edges
+    for(l=1; l<a; l++)
+        injectEdges(mg, &mg->levels[l], l);
+    injectEdges(mg, &mg->slab, a);
+
+    if(mg->world_rank == 0) {
+        for(l=a; l<mg->numLevels; l++)
+            injectEdges(mg, &mg->levels[l], l);
+        smoothLevel(mg, &mg->levels[mg->numLevels-1], MG_COARSE_SWEEPS);
+
+        for(l=mg->numLevels-2; l>=a; l--) {
+            clearPlane(mg->levels[l].rhs, mg->levels[l].n, mg->levels[l].n);
+            prolongLevel(&mg->levels[l+1], &mg->levels[l], false);
+            vCycle(mg, l);
+        }
+    }
+    scatterLevel(mg);
+
+    for(l=a-1; l>=0; l--) {
+        coarse = l+1 == a ? &mg->slab : &mg->levels[l+1];
+        if(mg->levels[l].rhs)
+            clearPlane(mg->levels[l].rhs, mg->levels[l].numRows,
+                mg->levels[l].n);
+        prolongLevel(coarse, &mg->levels[l], false);
+        exchangeHalos(mg->levels[l].u, mg->levels[l].numRows,
+            mg->levels[l].n, mg->world_rank, mg->world_size);
+        vCycle(mg, l);
+    }
+}
+
+/**
+ * @brief Builds the multigrid hierarchy for this process's part of the plane.
+ *         Levels stay split between the processes while each of them owns
+ *         enough rows, after which they are agglomerated onto process 0
+ * @param mg the multigrid hierarchy to fill in
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved red-black kernel used to smooth the finest level
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ */
+void newMultigrid(Multigrid* mg, double** plane, int numRows, int sizeOfPlane,
+    int firstRow, Kernel kernel, int world_rank, int world_size)
+{
+    int n = sizeOfPlane;
+    int owned, minOwned, first, last, stride, l;
+    int rows[2];
+    int* all = ( int* )malloc(2 * (size_t)world_size * sizeof(int));
+    double* edge;
+
+    mg->relaxRow = rowKernel(kernel, false);
+    mg->world_rank = world_rank;
+    mg->world_size = world_size;
+
+    // Coarsen until the grid has at most 2x2 cells inside its edges
+    mg->numLevels = 1;
+    for(int m=n; m>4; m=coarseSize(m))
+        mg->numLevels++;
+    mg->levels = ( MultigridLevel* )calloc((size_t)mg->numLevels,
+        sizeof(MultigridLevel));
+    mg->levels[0].n = n;
+    for(l=1; l<mg->numLevels; l++)
+        mg->levels[l].n = coarseSize(mg->levels[l-1].n);
+
+    mg->levels[0].numRows = numRows;
+    mg->levels[0].firstRow = firstRow;
+    mg->levels[0].distributed = true;
+    mg->levels[0].u = plane;
+    mg->levels[0].res = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    clearPlane(mg->levels[0].res, numRows, n);
+
+    // Every process keeps a copy of the plane's edges for the coarser levels
+    mg->top = ( double* )malloc(4 * (size_t)n * sizeof(double));
+    mg->bottom = mg->top + n;
+    mg->left = mg->bottom + n;
+    mg->right = mg->left + n;
+    if(world_rank == 0)
+        memcpy(mg->top, plane[0], (size_t)n * sizeof(double));
+    if(world_rank == world_size-1)
+        memcpy(mg->bottom, plane[numRows-1], (size_t)n * sizeof(double));
+    MPI_Bcast(mg->top, n, MPI_DOUBLE, 0, planeComm);
+    MPI_Bcast(mg->bottom, n, MPI_DOUBLE, world_size-1, planeComm);
+
+    rows[0] = firstRow+1;
+    rows[1] = numRows-2;
+    MPI_Allgather(rows, 2, MPI_INT, all, 2, MPI_INT, planeComm);
+    mg->counts = ( int* )malloc(2 * (size_t)world_size * sizeof(int));
+    mg->displs = mg->counts + world_size;
+    for(int r=0; r<world_size; r++) {
+        mg->displs[r] = all[2*r];
+        mg->counts[r] = all[2*r+1];
+    }
+    edge = ( double* )malloc(2 * (size_t)numRows * sizeof(double));
+    for(int i=1; i<numRows-1; i++) {
+        edge[i] = plane[i][0];
+        edge[numRows+i] = plane[i][n-1];
+    }
+    MPI_Allgatherv(&edge[1], numRows-2, MPI_DOUBLE, mg->left, mg->counts,
+        mg->displs, MPI_DOUBLE, planeComm);
+    MPI_Allgatherv(&edge[numRows+1], numRows-2, MPI_DOUBLE, mg->right,
+        mg->counts, mg->displs, MPI_DOUBLE, planeComm);
+    free(edge);
+
+    /* Each process owns the rows of a coarser level that sit on rows it owns
+        of the finer level, so restriction and interpolation only need the
+        edge rows. Split levels until a process would own too few rows */
+    mg->agglomerate = mg->numLevels;
+    for(l=1; l<mg->numLevels; l++) {
+        first = (mg->levels[l-1].firstRow + 2)/2;
+        last = (mg->levels[l-1].firstRow + mg->levels[l-1].numRows - 2)/2;
+        owned = last - first + 1;
+        MPI_Allreduce(&owned, &minOwned, 1, MPI_INT, MPI_MIN, planeComm);
+
+        if(minOwned < MG_MIN_ROWS || l == mg->numLevels-1) {
+            mg->agglomerate = l;
+            mg->slab.n = mg->levels[l].n;
+            mg->slab.numRows = owned + 2;
+            mg->slab.firstRow = first - 1;
+            mg->slab.distributed = true;
+            allocLevel(&mg->slab);
+            break;
+        }
+        mg->levels[l].numRows = owned + 2;
+        mg->levels[l].firstRow = first - 1;
+        mg->levels[l].distributed = true;
+        allocLevel(&mg->levels[l]);
+    }
+
+    if(mg->numLevels == 1) {
+        free(all);
+        return;
+    }
+
+    // Process 0 holds the agglomerated levels whole
+    if(world_rank == 0) {
+        for(l=mg->agglomerate; l<mg->numLevels; l++) {
+            mg->levels[l].numRows = mg->levels[l].n;
+            allocLevel(&mg->levels[l]);
+        }
+    }
+
+    // Where the rows owned and held by each process sit in the whole level
+    rows[0] = mg->slab.firstRow;
+    rows[1] = mg->slab.numRows;
+    MPI_Allgather(rows, 2, MPI_INT, all, 2, MPI_INT, planeComm);
+    stride = (int)(mg->slab.u[1] - mg->slab.u[0]);
+    mg->slabFirst = ( int* )malloc(2 * (size_t)world_size * sizeof(int));
+    mg->slabRows = mg->slabFirst + world_size;
+    for(int r=0; r<world_size; r++) {
+        mg->slabFirst[r] = all[2*r];
+        mg->slabRows[r] = all[2*r+1];
+        mg->displs[r] = (all[2*r]+1) * stride;
+        mg->counts[r] = (all[2*r+1]-2) * stride;
+    }
+    free(all);
+}
+
+/**
+ * @brief Frees the multigrid hierarchy, apart from the plane itself
+ * @param mg the multigrid hierarchy
+ */
+void freeMultigrid(Multigrid* mg) {
+    freePlane(mg->levels[0].res);
+    for(int l=1; l<mg->numLevels; l++)
+        if(mg->levels[l].u)
+            freeLevel(&mg->levels[l]);
+    if(mg->numLevels > 1) {
+        freeLevel(&mg->slab);
+        free(mg->slabFirst);
+    }
+    free(mg->levels);
+    free(mg->top);
+    free(mg->counts);
+}
+
+/**
+ * @brief Solves this process's part of the plane with multigrid. A full
+ *         multigrid cycle is done first, followed by V-cycles until the
+ *         largest change made to any cell by a cycle is within the tolerance
+ *         on every process
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to solve the plane to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved red-black kernel used to smooth the finest level
+ * @return the number of cycles taken
+ */
+unsigned long multigridPlane(double** plane, int numRows, int sizeOfPlane,
+    double tolerance, int world_rank, int world_size, int firstRow,
+    Kernel kernel)
+{
+    unsigned long iterations = 0;
+    double delta, maxDelta;
+    Multigrid mg;
+    double** prev = newSubPlane((unsigned int)sizeOfPlane,
+        (unsigned int)numRows);
+
+    newMultigrid(&mg, plane, numRows, sizeOfPlane, firstRow, kernel,
+        world_rank, world_size);
+
+    do {
+        for(int i=1; i<numRows-1; i++)
+            memcpy(&prev[i][1], &plane[i][1],
+                (size_t)(sizeOfPlane-2) * sizeof(double));
+
+        if(iterations == 0 && mg.numLevels > 1)
+            fullMultigrid(&mg);
+        else
+            vCycle(&mg, 0);
+        iterations++;
+
+        maxDelta = 0;
+        for(int i=1; i<numRows-1; i++) {
+            for(int j=1; j<sizeOfPlane-1; j++) {
+                delta = fabs(plane[i][j]-prev[i][j]);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &maxDelta, 1, MPI_DOUBLE, MPI_MAX,
+            planeComm);
+    } while(tolerance < maxDelta);
+
+    freeMultigrid(&mg);
+    freePlane(prev);
+    return iterations;
+}
+
+/**
+ * @brief Applies the 5-point Laplacian to the cells inside a 2D array whose
+ *         edges are zero. This is the matrix of the linear system that
+ *         relaxation solves, applied without forming it. The edge rows from
+ *         the neighbouring processes must already have been swapped
+ * @param in pointer to the 2D array to apply the Laplacian to
+ * @param out pointer to the 2D array to write the result into
+ * @param numRows number of rows in the arrays
+ * @param sizeOfPlane length of each row in the arrays
+ * @return the dot product of in and out over this process's rows
+ */
+double applyLaplacian(double** in, double** out, int numRows,
+    int sizeOfPlane)
+{
+    double dot = 0;
+
+    for(int i=1; i<numRows-1; i++) {
+        for(int j=1; j<sizeOfPlane-1; j++) {
+            out[i][j] = 4*in[i][j] - in[i-1][j] - in[i+1][j] - in[i][j-1]
+                - in[i][j+1];
+            dot += in[i][j] * out[i][j];
+        }
+    }
+    return dot;
+}
+
+/**
+ * @brief Calculates the residual of the plane, i.e. how far each cell is from
+ *         the average of its neighbours times four
+ * @param plane pointer to the 2D array
+ * @param res pointer to the 2D array to write the residual into
+ * @param numRows number of rows in the arrays
+ * @param sizeOfPlane length of each row in the arrays
+ * @return the dot product of the residual with itself over this process's rows
+ */
+double residualPlane(double** plane, double** res, int numRows,
+    int sizeOfPlane)
+{
+    double dot = 0;
+
+    for(int i=1; i<numRows-1; i++) {
+        for(int j=1; j<sizeOfPlane-1; j++) {
+            res[i][j] = plane[i-1][j] + plane[i+1][j] + plane[i][j-1]
+                + plane[i][j+1] - 4*plane[i][j];
+            dot += res[i][j] * res[i][j];
+        }
+    }
+    return dot;
+}
+
+/**
+ * @brief Solves this process's part of the plane with the conjugate gradient
+ *         method, stopping once the largest change made to any cell by an
+ *         iteration is within the tolerance on every process
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to solve the plane to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @return the number of iterations taken
+ */
+unsigned long conjugateGradientPlane(double** plane, int numRows,
+    int sizeOfPlane, double tolerance, int world_rank, int world_size)
+{
+    unsigned long iterations = 0;
+    int n = sizeOfPlane;
+    double alpha, beta, gamma, nextGamma, delta, change, maxDelta;
+    double** res = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    double** dir = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    double** prod = newSubPlane((unsigned int)n, (unsigned int)numRows);
+
+    // The search direction's edges must stay zero for applyLaplacian
+    clearPlane(res, numRows, n);
+    clearPlane(dir, numRows, n);
+    clearPlane(prod, numRows, n);
+
+    exchangeHalos(plane, numRows, n, world_rank, world_size);
+    gamma = residualPlane(plane, res, numRows, n);
+    MPI_Allreduce(MPI_IN_PLACE, &gamma, 1, MPI_DOUBLE, MPI_SUM,
+        planeComm);
+    for(int i=1; i<numRows-1; i++)
+        memcpy(&dir[i][1], &res[i][1], (size_t)(n-2) * sizeof(double));
+
+    // A residual of zero means the plane is already solved
+    while(gamma > 0) {
+        exchangeHalos(dir, numRows, n, world_rank, world_size);
+        delta = applyLaplacian(dir, prod, numRows, n);
+        MPI_Allreduce(MPI_IN_PLACE, &delta, 1, MPI_DOUBLE, MPI_SUM,
+            planeComm);
+        alpha = gamma/delta;
+
+        maxDelta = 0;
+        nextGamma = 0;
+        for(int i=1; i<numRows-1; i++) {
+            for(int j=1; j<n-1; j++) {
+                change = alpha * dir[i][j];
+                plane[i][j] += change;
+                res[i][j] -= alpha * prod[i][j];
+                nextGamma += res[i][j] * res[i][j];
+                change = fabs(change);
+                maxDelta = change > maxDelta ? change : maxDelta;
+            }
+        }
+        iterations++;
+        MPI_Allreduce(MPI_IN_PLACE, &maxDelta, 1, MPI_DOUBLE, MPI_MAX,
+            planeComm);
+        if(!(tolerance < maxDelta))
+            break;
+        MPI_Allreduce(MPI_IN_PLACE, &nextGamma, 1, MPI_DOUBLE, MPI_SUM,
+            planeComm);
+
+        beta = nextGamma/gamma;
+        gamma = nextGamma;
+        for(int i=1; i<numRows-1; i++)
+            for(int j=1; j<n-1; j++)
+                dir[i][j] = res[i][j] + beta * dir[i][j];
+    }
+
+    // The edge rows are left as they would be after any other method
+    exchangeHalos(plane, numRows, n, world_rank, world_size);
+    freePlane(res);
+    freePlane(dir);
+    freePlane(prod);
+    return iterations;
+}
+
+/**
+ * @brief Combines the sums of the pipelined conjugate gradient method, adding
+ *         the two dot products and keeping the largest change of each
+ * @param in the dot products and largest change from another process
+ * @param inout the dot products and largest change to combine them into
+ * @param len number of sets of dot products and largest change
+ * @param type the datatype of one set, unused
+ */
+void sumDotsMaxDelta(void* in, void* inout, int* len, MPI_Datatype* type) {
+    const double* from = ( const double* )in;
+    double* to = ( double* )inout;
+
+    (void)type;
+    for(int i=0; i<*len; i++) {
+        to[3*i] += from[3*i];
+        to[3*i+1] += from[3*i+1];
+        if(from[3*i+2] > to[3*i+2])
+            to[3*i+2] = from[3*i+2];
+    }
+}
+
+/**
+ * @brief Solves this process's part of the plane with the pipelined conjugate
+ *         gradient method. It takes the same steps as conjugate gradients, but
+ *         rearranged so both dot products of an iteration are found together,
+ *         in the same pass as the vector updates, and the next product with
+ *         the Laplacian does not depend on them. Their sum over the processes
+ *         and the largest change are found with a single MPI_Iallreduce while
+ *         that product is found
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param sizeOfPlane length of each row in the array
+ * @param tolerance the tolerance to solve the plane to
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ * @return the number of iterations taken
+ */
+unsigned long pipelinedCGPlane(double** plane, int numRows, int sizeOfPlane,
+    double tolerance, int world_rank, int world_size)
+{
+    unsigned long iterations = 0;
+    int n = sizeOfPlane;
+    double alpha = 0, beta = 0, lastGamma = 0;
+    double change;
+    // The residual's dot product with itself and with w, and the largest change
+    double dots[3];
+    MPI_Request request;
+    MPI_Datatype sums;
+    MPI_Op combine;
+    // The residual, its product with the Laplacian, and their recurrences
+    double** res = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    double** w = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    double** aw = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    double** dir = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    double** s = newSubPlane((unsigned int)n, (unsigned int)numRows);
+    double** z = newSubPlane((unsigned int)n, (unsigned int)numRows);
+
+    clearPlane(res, numRows, n);
+    clearPlane(w, numRows, n);
+    clearPlane(aw, numRows, n);
+    clearPlane(dir, numRows, n);
+    clearPlane(s, numRows, n);
+    clearPlane(z, numRows, n);
+
+    // One set is reduced whole, so the sums and the maximum never get split
+    MPI_Type_contiguous(3, MPI_DOUBLE, &sums);
+    MPI_Type_commit(&sums);
+    MPI_Op_create(sumDotsMaxDelta, 1, &combine);
+
+    exchangeHalos(plane, numRows, n, world_rank, world_size);
+    dots[0] = residualPlane(plane, res, numRows, n);
+    exchangeHalos(res, numRows, n, world_rank, world_size);
+    dots[1] = applyLaplacian(res, w, numRows, n);
+    dots[2] = 0;
+    MPI_Iallreduce(MPI_IN_PLACE, dots, 1, sums, combine, planeComm, &request);
+    exchangeHalos(w, numRows, n, world_rank, world_size);
+    applyLaplacian(w, aw, numRows, n);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+
+    // A residual of zero means the plane is already solved
+    while(dots[0] > 0) {
+        if(iterations > 0) {
+            beta = dots[0]/lastGamma;
+            alpha = dots[0]/(dots[1] - beta*dots[0]/alpha);
+        } else {
+            alpha = dots[0]/dots[1];
+        }
+        lastGamma = dots[0];
+
+        dots[0] = 0;
+        dots[1] = 0;
+        dots[2] = 0;
+        for(int i=1; i<numRows-1; i++) {
+            for(int j=1; j<n-1; j++) {
+                z[i][j] = aw[i][j] + beta * z[i][j];
+                s[i][j] = w[i][j] + beta * s[i][j];
+                dir[i][j] = res[i][j] + beta * dir[i][j];
+                change = alpha * dir[i][j];
+                plane[i][j] += change;
+                res[i][j] -= alpha * s[i][j];
+                w[i][j] -= alpha * z[i][j];
+                dots[0] += res[i][j] * res[i][j];
+                dots[1] += w[i][j] * res[i][j];
+                change = fabs(change);
+                dots[2] = change > dots[2] ? change : dots[2];
+            }
+        }
+        iterations++;
+
+        // Find the next product with the Laplacian while the sums are found
+        MPI_Iallreduce(MPI_IN_PLACE, dots, 1, sums, combine, planeComm,
+            &request);
+        exchangeHalos(w, numRows, n, world_rank, world_size);
+        applyLaplacian(w, aw, numRows, n);
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+
+        if(!(tolerance < dots[2]))
+            break;
+    }
+    MPI_Op_free(&combine);
+    MPI_Type_free(&sums);
+
+    // The edge rows are left as they would be after any other method
+    exchangeHalos(plane, numRows, n, world_rank, world_size);
+    freePlane(res);
+    freePlane(w);
+    freePlane(aw);
+    freePlane(dir);
+    freePlane(s);
+    freePlane(z);
+    return iterations;
+}
+
+/**
+ * @brief Performs an in place radix-2 FFT
+ * @param plan the plan whose twiddle factors are used
+ * @param data the values to transform, of the plan's power of two size
+ * @param inverse true for the inverse transform, which is not scaled
  */
-long double toSeconds(struct timespec start, struct timespec end) {
-    long long difSec = end.tv_sec - start.tv_sec;
-    long long difNSec = end.tv_nsec - start.tv_nsec;
-    long long totalNS = difSec*1000000000L + difNSec;
-    return (long double) totalNS / 1000000000.0;
+void fft(const DstPlan* plan, double complex* data, bool inverse) {
+    int size = plan->size;
+    int bit, j = 0;
+    double complex u, v, w;
+
+    // Put the values in bit reversed order
+    for(int i=1; i<size; i++) {
+        for(bit=size>>1; j & bit; bit>>=1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j) {
+            u = data[i];
+            data[i] = data[j];
+            data[j] = u;
+        }
+    }
+
+    for(int len=2; len<=size; len<<=1) {
+        for(int i=0; i<size; i+=len) {
+            for(int k=0; k<len/2; k++) {
+                w = plan->twiddle[k * (size/len)];
+                v = data[i+k+len/2] * (inverse ? conj(w) : w);
+                u = data[i+k];
+                data[i+k] = u + v;
+                data[i+k+len/2] = u - v;
+            }
+        }
+    }
 }
 
 /**
- * @brief Mallocs memory for a n*rows 2D array. Memory for array is contiguous,
-           for when I was using MPI_Gatherv
- * @param n the size of each row in the 2D array
- * @param rows the number of rows in the 2D array
- * @return a pointer to an array of pointers to each row in the 2D array
+ * @brief Makes a plan for discrete sine transforms of rows of a given length
+ * @param length number of values in each row
+ * @return the plan
  */
-double** newSubPlane(unsigned int n, unsigned int rows) {
-    double** plane  = ( double** )malloc(rows * sizeof(double*));
-    plane[0] = ( double * )malloc(rows * n * sizeof(double));
+DstPlan newDstPlan(int length) {
+    DstPlan plan;
+    // Length of the odd extension of a row
+    int m = 2*(length+1);
+    long long phase;
 
-    for(unsigned int i = 0; i<rows; i++)
-        plane[i] = (*plane + n * i);
+    plan.length = length;
+    plan.size = 1;
+    while(plan.size < 2*m-1)
+        plan.size <<= 1;
 
-    return plane;
+    plan.chirp = ( double complex* )malloc((size_t)m * sizeof(double complex));
+    plan.kernel = ( double complex* )calloc((size_t)plan.size,
+        sizeof(double complex));
+    plan.twiddle = ( double complex* )malloc((size_t)(plan.size/2)
+        * sizeof(double complex));
+    plan.work = ( double complex* )malloc((size_t)plan.size
+        * sizeof(double complex));
+
+    for(int k=0; k<plan.size/2; k++)
+        plan.twiddle[k] = cexp(-2*M_PI*I*k/plan.size);
+    // k^2 is taken modulo 2m so large k keep their precision
+    for(int k=0; k<m; k++) {
+        phase = (long long)k*k % (2*m);
+        plan.chirp[k] = cexp(-M_PI*I*(double)phase/m);
+    }
+    plan.kernel[0] = conj(plan.chirp[0]);
+    for(int k=1; k<m; k++) {
+        plan.kernel[k] = conj(plan.chirp[k]);
+        plan.kernel[plan.size-k] = conj(plan.chirp[k]);
+    }
+    fft(&plan, plan.kernel, false);
+
+    return plan;
 }
 
 /**
- * @brief Populates the plane's walls with the values provided, and sets the
- *         centre parts to zero
+ * @brief Frees the memory held by a plan
+ * @param plan the plan
+ */
+void freeDstPlan(DstPlan* plan) {
+    free(plan->chirp);
+    free(plan->kernel);
+    free(plan->twiddle);
+    free(plan->work);
+}
+
+/**
+ * @brief Replaces two rows with their type I discrete sine transforms, i.e.
+ *         x[k] = sum over j of x[j]*sin(pi*(j+1)*(k+1)/(length+1)). The rows
+ *         are real, so the second is transformed as the imaginary part of the
+ *         first for free
+ * @param plan plan for rows of this length
+ * @param x the first row to transform
+ * @param y the second row to transform, or NULL for only one row
+ */
+void dstRows(DstPlan* plan, double* x, double* y) {
+    int n = plan->length;
+    int m = 2*(n+1);
+    double complex* work = plan->work;
+    double complex val;
+
+    // The odd extension of the rows, multiplied by the chirp
+    work[0] = 0;
+    work[n+1] = 0;
+    for(int j=1; j<=n; j++) {
+        val = y ? CMPLX(x[j-1], y[j-1]) : x[j-1];
+        work[j] = val * plan->chirp[j];
+        work[m-j] = -val * plan->chirp[m-j];
+    }
+    memset(&work[m], 0, (size_t)(plan->size-m) * sizeof(double complex));
+
+    fft(plan, work, false);
+    for(int k=0; k<plan->size; k++)
+        work[k] *= plan->kernel[k];
+    fft(plan, work, true);
+
+    // The FFT of an odd extension is -2i times the sine transform
+    for(int k=1; k<=n; k++) {
+        val = plan->chirp[k] * work[k] / (2.0 * plan->size);
+        x[k-1] = -cimag(val);
+        if(y)
+            y[k-1] = creal(val);
+    }
+}
+
+/**
+ * @brief Gets the eigenvalues of the 1D second difference matrix of a given
+ *         size, which the sine transform diagonalises
+ * @param length size of the matrix
+ * @return array of the eigenvalues
+ */
+double* laplacianEigenvalues(int length) {
+    double* eigen = ( double* )malloc((size_t)length * sizeof(double));
+
+    for(int k=0; k<length; k++)
+        eigen[k] = 2 - 2*cos(M_PI*(k+1)/(length+1));
+    return eigen;
+}
+
+/**
+ * @brief Transposes the inside of the plane when it is split into rows
+ *         between the processes, so each process ends up with the same rows
+ *         of the transpose as it had of the original
+ * @param in this process's rows of the inside of the plane
+ * @param out this process's rows of the transpose
+ * @param inner number of rows and columns inside the plane
+ * @param rowCounts number of rows each process has
+ * @param rowStarts index of the first row each process has
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ */
+void transposeSlabs(const double* in, double* out, int inner,
+    const int* rowCounts, const int* rowStarts, int world_rank,
+    int world_size)
+{
+    int myRows = rowCounts[world_rank];
+    int pos = 0;
+    int* counts = ( int* )calloc(2 * (size_t)world_size, sizeof(int));
+    int* displs = counts + world_size;
+    double* send = ( double* )calloc((size_t)myRows * (size_t)inner,
+        sizeof(double));
+    double* recv = ( double* )malloc((size_t)myRows * (size_t)inner
+        * sizeof(double));
+
+    /* The block for each process is the part of this process's rows in the
+        columns that process will have. The counts are the same both ways */
+    for(int q=0; q<world_size; q++) {
+        counts[q] = myRows * rowCounts[q];
+        displs[q] = pos;
+        for(int i=0; i<myRows; i++)
+            for(int j=0; j<rowCounts[q]; j++)
+                send[pos++] = in[i*inner + rowStarts[q] + j];
+    }
+
+    MPI_Alltoallv(send, counts, displs, MPI_DOUBLE, recv, counts, displs,
+        MPI_DOUBLE, planeComm);
+
+    for(int q=0; q<world_size; q++)
+        for(int i=0; i<rowCounts[q]; i++)
+            for(int j=0; j<myRows; j++)
+                out[j*inner + rowStarts[q] + i] = recv[displs[q] + i*myRows
+                    + j];
+
+    free(send);
+    free(recv);
+    free(counts);
+}
+
+/**
+ * @brief Transforms this process's rows of the inside of the plane, pairing
+ *         rows by their index in the whole plane so the result doesn't depend
+ *         on how the rows are split. A pair split between two processes is
+ *         swapped and transformed by both
+ * @param plan plan for rows of this length
+ * @param rows this process's rows of the inside of the plane
+ * @param inner number of rows and columns inside the plane
+ * @param rowCounts number of rows each process has
+ * @param rowStarts index of the first row each process has
+ * @param world_rank world_rank of this process
+ * @param world_size number of MPI_processes
+ */
+void dstSlab(DstPlan* plan, double* rows, int inner, const int* rowCounts,
+    const int* rowStarts, int world_rank, int world_size)
+{
+    int myRows = rowCounts[world_rank];
+    int start = rowStarts[world_rank];
+    bool splitUp = world_rank > 0 && start % 2 == 1;
+    bool splitDown = world_rank < world_size-1 && (start+myRows) % 2 == 1;
+    int numRequests = 0;
+    int i = 0;
+    double* above = ( double* )malloc(2 * (size_t)inner * sizeof(double));
+    double* below = above + inner;
+    MPI_Request requests[4];
+
+    // Swap the other half of each split pair before anything is transformed
+    if(splitUp) {
+        MPI_Irecv(above, inner, MPI_DOUBLE, world_rank-1, 0, planeComm,
+            &requests[numRequests++]);
+        MPI_Isend(rows, inner, MPI_DOUBLE, world_rank-1, 0, planeComm,
+            &requests[numRequests++]);
+    }
+    if(splitDown) {
+        MPI_Irecv(below, inner, MPI_DOUBLE, world_rank+1, 0, planeComm,
+            &requests[numRequests++]);
+        MPI_Isend(&rows[(myRows-1)*inner], inner, MPI_DOUBLE, world_rank+1,
+            0, planeComm, &requests[numRequests++]);
+    }
+    MPI_Waitall(numRequests, requests, MPI_STATUSES_IGNORE);
+
+    // The even row of a pair is always the real part
+    if(splitUp) {
+        dstRows(plan, above, rows);
+        i = 1;
+    }
+    for(; i+1 < myRows; i+=2)
+        dstRows(plan, &rows[i*inner], &rows[(i+1)*inner]);
+    if(i < myRows)
+        dstRows(plan, &rows[i*inner], splitDown ? below : NULL);
+    free(above);
+}
+
+/**
+ * @brief Solves this process's part of the plane directly with discrete sine
+ *         transforms. The sine transform along each axis diagonalises the
+ *         5-point Laplacian, so the transformed edges are divided by its
+ *         eigenvalues and then transformed back. Each process transforms its
+ *         own rows, and the plane is transposed between the processes to
+ *         transform the columns. This gives the exact solution of the system
+ *         that relaxation converges to, without iterating
  * @param plane pointer to the 2D array
-  * @param numRows number of rows in the array
+ * @param numRows number of rows in the array
  * @param sizeOfPlane length of each row in the array
- * @param top value to put in top edge of 2D array
- * @param bottom value to put in bottom edge of 2D array
- * @param farLeft value to put in left edge of 2D array
- * @param farRight value to put in right edge of 2D array
  * @param world_rank world_rank of this process
  * @param world_size number of MPI_processes
+ * @param firstRow index in the whole plane of the first row in the array
+ * @return the number of iterations taken, which is always 1
  */
-void populateSubPlane(double** plane, int sizeOfPlane, int numRows, double top,
-    double bottom, double farLeft, double farRight, int world_rank,
-    int world_size)
-{   
-    for(int i=0; i<numRows; i++) {
-        for(int j=0; j<sizeOfPlane; j++) {
-            if(j == 0) {
-                // Left
-                plane[i][j] = farLeft;
-            } else if(i == 0 && world_rank == 0) {
-                // Top
-                plane[i][j] = top;
-            } else if(j == sizeOfPlane-1) {
-                // Right
-                plane[i][j] = farRight;
-            } else if(i == numRows-1 && world_rank == world_size-1) {
-                // Bottom
-                plane[i][j] = bottom;
-            } else {
-                plane[i][j] = 0;
-            }
+unsigned long dstPlane(double** plane, int numRows, int sizeOfPlane,
+    int world_rank, int world_size, int firstRow)
+{
+    int n = sizeOfPlane;
+    int inner = n-2;
+    int myRows = numRows-2;
+    int row, first[2];
+    double scale = 4.0/((double)(inner+1)*(inner+1));
+    int* rowCounts = ( int* )malloc(2 * (size_t)world_size * sizeof(int));
+    int* rowStarts = rowCounts + world_size;
+    int* all = ( int* )malloc(2 * (size_t)world_size * sizeof(int));
+    double* rhs = ( double* )calloc((size_t)myRows*(size_t)inner,
+        sizeof(double));
+    double* trans = ( double* )malloc((size_t)myRows*(size_t)inner
+        * sizeof(double));
+    double* eigen = laplacianEigenvalues(inner);
+    DstPlan plan = newDstPlan(inner);
+
+    first[0] = myRows;
+    first[1] = firstRow;
+    MPI_Allgather(first, 2, MPI_INT, all, 2, MPI_INT, planeComm);
+    for(int q=0; q<world_size; q++) {
+        rowCounts[q] = all[2*q];
+        rowStarts[q] = all[2*q+1];
+    }
+    free(all);
+
+    // Each cell next to an edge takes the edge's value as its right hand side
+    for(int i=0; i<myRows; i++) {
+        row = firstRow + i;
+        for(int j=0; j<inner; j++) {
+            rhs[i*inner+j] = (row == 0 ? plane[i][j+1] : 0)
+                + (row == inner-1 ? plane[i+2][j+1] : 0)
+                + (j == 0 ? plane[i+1][0] : 0)
+                + (j == inner-1 ? plane[i+1][n-1] : 0);
         }
     }
+    dstSlab(&plan, rhs, inner, rowCounts, rowStarts, world_rank,
+        world_size);
+
+    // Transform the columns as rows of the transpose, then divide
+    transposeSlabs(rhs, trans, inner, rowCounts, rowStarts, world_rank,
+        world_size);
+    dstSlab(&plan, trans, inner, rowCounts, rowStarts, world_rank,
+        world_size);
+    for(int i=0; i<myRows; i++)
+        for(int j=0; j<inner; j++)
+            trans[i*inner+j] /= eigen[firstRow+i] + eigen[j];
+    dstSlab(&plan, trans, inner, rowCounts, rowStarts, world_rank,
+        world_size);
+
+    // The sine transform is its own inverse, apart from the scale
+    transposeSlabs(trans, rhs, inner, rowCounts, rowStarts, world_rank,
+        world_size);
+    dstSlab(&plan, rhs, inner, rowCounts, rowStarts, world_rank,
+        world_size);
+    for(int i=0; i<myRows; i++)
+        for(int j=0; j<inner; j++)
+            plane[i+1][j+1] = rhs[i*inner+j] * scale;
+
+    // The edge rows are left as they would be after any other method
+    exchangeHalos(plane, numRows, n, world_rank, world_size);
+    freeDstPlan(&plan);
+    free(eigen);
+    free(trans);
+    free(rhs);
+    free(rowCounts);
+    return 1;
 }
 
+/**
+ * @brief Everything a thread needs to relax its rows of this process's part
+ *         of the plane
+ */
+typedef struct {
+    double** plane;
+    int numRows;
+    int sizeOfPlane;
+    int firstRow;
+    int rowStart;
+    int rowEnd;
+    int id;
+    int numThreads;
+    int cpu;
+    int world_rank;
+    int world_size;
+    double tolerance;
+    Kernel kernel;
+    ThreadDelta* deltas;
+    pthread_barrier_t* barrier;
+    double* globalDelta;
+    OmegaEstimate omega;
+    unsigned long iterations;
+} Worker;
 
 /**
- * @brief Performs the relaxation algorithm on a 2D array
+ * @brief Relaxes a thread's rows with red-black ordering until the whole
+ *         plane has converged. Only thread 0 talks to the other processes,
+ *         while the rest of the threads wait at a barrier
+ * @param arg pointer to the thread's Worker
+ * @return NULL
+ */
+void* relaxWorker(void* arg) {
+    Worker* worker = ( Worker* )arg;
+    RowKernel relaxRow = rowKernel(worker->kernel, worker->omega.over);
+    cpu_set_t cpus;
+    int i, colour;
+    double delta, maxDelta;
+
+    // Keep the thread on one core, so its rows stay in that core's cache
+    if(worker->cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET((size_t)worker->cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    do {
+        worker->iterations++;
+        maxDelta = 0;
+
+        // Relax all of the red cells, then all of the black cells
+        for(colour=0; colour<2; colour++) {
+            for(i=worker->rowStart; i<worker->rowEnd; i++) {
+                delta = relaxRow(worker->plane[i-1], worker->plane[i],
+                    worker->plane[i+1],
+                    colourStart(worker->firstRow+i, colour),
+                    worker->sizeOfPlane-1, worker->omega.omega);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
+            }
+            if(colour == 1)
+                worker->deltas[worker->id].maxDelta = maxDelta;
+
+            // Wait until every thread has finished this colour
+            pthread_barrier_wait(worker->barrier);
+            if(worker->id == 0) {
+                exchangeHalos(worker->plane, worker->numRows,
+                    worker->sizeOfPlane, worker->world_rank,
+                    worker->world_size);
+                if(colour == 1) {
+                    maxDelta = 0;
+                    for(i=0; i<worker->numThreads; i++)
+                        if(worker->deltas[i].maxDelta > maxDelta)
+                            maxDelta = worker->deltas[i].maxDelta;
+                    MPI_Allreduce(MPI_IN_PLACE, &maxDelta, 1, MPI_DOUBLE,
+                        MPI_MAX, planeComm);
+                    *worker->globalDelta = maxDelta;
+                }
+            }
+            // Wait for the new edge rows before relaxing the next colour
+            pthread_barrier_wait(worker->barrier);
+        }
+        // Every thread makes the same estimate of omega from the same change
+        updateOmega(&worker->omega, *worker->globalDelta);
+    } while(worker->tolerance < *worker->globalDelta);
+
+    return NULL;
+}
+
+/**
+ * @brief Performs the relaxation algorithm on this process's part of the
+ *         plane using several threads, each relaxing a block of its rows with
+ *         red-black ordering
  * @param plane pointer to the 2D array
  * @param numRows number of rows in the array
  * @param sizeOfPlane length of each row in the array
  * @param tolerance the tolerance to perform the relaxation algorithm to
  * @param world_rank world_rank of this process
  * @param world_size number of MPI_processes
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved red-black kernel used to relax each row
+ * @param numThreads number of threads to use, including this one
+ * @param omega over-relaxation factor, updated as it is estimated
  * @return the number of iterations taken to perform the relaxation algorithm
  */
-unsigned long relaxPlane(double** plane, int numRows, int sizeOfPlane,
-    double tolerance, int world_rank, int world_size)
+unsigned long relaxPlaneThreaded(double** plane, int numRows, int sizeOfPlane,
+    double tolerance, int world_rank, int world_size, int firstRow,
+    Kernel kernel, int numThreads, OmegaEstimate* omega)
 {
+    int sizeOfInner = numRows-2;
+    int rowsPerThreadE = sizeOfInner/numThreads;
+    int remainingRows = sizeOfInner - numThreads * rowsPerThreadE;
+    pthread_t* threads = ( pthread_t* )malloc((size_t)numThreads
+        * sizeof(pthread_t));
+    Worker* workers = ( Worker* )malloc((size_t)numThreads * sizeof(Worker));
+    ThreadDelta* deltas = ( ThreadDelta* )aligned_alloc(sizeof(ThreadDelta),
+        (size_t)numThreads * sizeof(ThreadDelta));
+    pthread_barrier_t barrier;
+    unsigned long iterations;
+    double globalDelta = 0;
+    int rowStart = 1;
 
-    unsigned long iterations = 0;
-    int i, j, endFlag;
-    double pVal;
+    MPI_Comm nodeComm;
+    int nodeRank, nodeSize, numCpus, sharing = 0, cpuOffset = 0;
+    cpu_set_t allowed;
+    cpu_set_t* nodeMasks;
+    bool pin;
 
-    int sizeOfInner = sizeOfPlane-2;
-    int sendBot = numRows-2; 
-    int recBot = numRows-1;
-    MPI_Request myRequest1, myRequest2;
+    /* Pin the threads to the cores this process is allowed to use. If the
+        launcher did not bind each process to its own cores, the processes
+        on the node with the same cores split them between themselves */
+    MPI_Comm_split_type(planeComm, MPI_COMM_TYPE_SHARED, world_rank,
+        MPI_INFO_NULL, &nodeComm);
+    MPI_Comm_rank(nodeComm, &nodeRank);
+    MPI_Comm_size(nodeComm, &nodeSize);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    numCpus = CPU_COUNT(&allowed);
+    nodeMasks = ( cpu_set_t* )malloc((size_t)nodeSize * sizeof(cpu_set_t));
+    MPI_Allgather(&allowed, sizeof(cpu_set_t), MPI_BYTE, nodeMasks,
+        sizeof(cpu_set_t), MPI_BYTE, nodeComm);
+    for(int q=0; q<nodeSize; q++) {
+        if(CPU_EQUAL(&nodeMasks[q], &allowed)) {
+            cpuOffset += q < nodeRank ? numThreads : 0;
+            sharing++;
+        }
+    }
+    free(nodeMasks);
+    MPI_Comm_free(&nodeComm);
 
-    // Main Loop
-    do {
-        endFlag = true;
-        iterations++;
+    // Threads pinned to the same core would take turns, so leave them be
+    pin = numCpus >= sharing * numThreads;
+    if(!pin)
+        fprintf(stderr, "Process %d shares %d cores with %d processes of %d "
+            "threads, so the threads are not pinned\n", world_rank, numCpus,
+            sharing, numThreads);
 
-        // Perform relaxation
-        for(i=1; i<recBot; i++) {
-            for(j=1; j<sizeOfPlane-1; j++) {
-                pVal = plane[i][j];
-                plane[i][j] = (plane[i-1][j] + plane[i+1][j] + plane[i][j-1]
-                    + plane[i][j+1])/4;
-                if(endFlag && tolerance < fabs(plane[i][j]-pVal)) {
-                    endFlag = false;
-                }
+    pthread_barrier_init(&barrier, NULL, (unsigned int)numThreads);
+
+    // Split the rows as evenly as possible, the first threads get any extra
+    for(int t=0; t<numThreads; t++) {
+        workers[t].plane = plane;
+        workers[t].numRows = numRows;
+        workers[t].sizeOfPlane = sizeOfPlane;
+        workers[t].firstRow = firstRow;
+        workers[t].rowStart = rowStart;
+        rowStart += rowsPerThreadE + (t < remainingRows ? 1 : 0);
+        workers[t].rowEnd = rowStart;
+        workers[t].id = t;
+        workers[t].numThreads = numThreads;
+        workers[t].world_rank = world_rank;
+        workers[t].world_size = world_size;
+        workers[t].tolerance = tolerance;
+        workers[t].kernel = kernel;
+        workers[t].deltas = deltas;
+        workers[t].barrier = &barrier;
+        workers[t].globalDelta = &globalDelta;
+        workers[t].omega = *omega;
+        workers[t].iterations = 0;
+
+        // Find the (cpuOffset + t)th core this process may use
+        workers[t].cpu = -1;
+        for(int c=0, seen=0; c<CPU_SETSIZE && pin; c++) {
+            if(CPU_ISSET((size_t)c, &allowed) && seen++ == cpuOffset + t) {
+                workers[t].cpu = c;
+                break;
             }
         }
+    }
 
-        // MPI communication to Send/Recieve data depending on the world_rank
-        if(world_rank==0) {
-            // Only send data down to process with world_rank 1
-            MPI_Isend(&plane[sendBot][1], sizeOfInner, MPI_DOUBLE, 1, 0,
-                MPI_COMM_WORLD, &myRequest1);
-            MPI_Recv(&plane[recBot][1], sizeOfInner, MPI_DOUBLE, 1, 0,
-                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        } else if(world_rank==world_size-1) {
-            // Only send and recive/data to the process above i.e. world_rank-1
-            MPI_Isend(&plane[1][1], sizeOfInner, MPI_DOUBLE, world_rank-1, 0,
-                MPI_COMM_WORLD, &myRequest1);
-            MPI_Recv(&plane[0][1], sizeOfInner, MPI_DOUBLE, world_rank-1, 0,
-                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        } else {
-            // Send new data up
-            MPI_Isend(&plane[1][1], sizeOfInner, MPI_DOUBLE, world_rank-1, 0,
-                MPI_COMM_WORLD, &myRequest1);
-            // Send new data down 
-            MPI_Isend(&plane[sendBot][1], sizeOfInner, MPI_DOUBLE, world_rank+1,
-                0, MPI_COMM_WORLD, &myRequest2);
-            // Receive new data from above
-            MPI_Recv(&plane[0][1], sizeOfInner, MPI_DOUBLE, world_rank-1, 0,
-                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            // Receive new data from below
-            MPI_Recv(&plane[recBot][1], sizeOfInner, MPI_DOUBLE, world_rank+1,
-                0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        }
-
-        // Compare and upate the endFlag for all of the MPI processes
-        MPI_Allreduce(MPI_IN_PLACE, &endFlag, 1, MPI_INT, MPI_LAND,
-            MPI_COMM_WORLD);
-        
-        
-    } while(!endFlag);
+    // This thread relaxes the first block of rows and does the messaging
+    for(int t=1; t<numThreads; t++)
+        pthread_create(&threads[t], NULL, relaxWorker, &workers[t]);
+    relaxWorker(&workers[0]);
+    for(int t=1; t<numThreads; t++)
+        pthread_join(threads[t], NULL);
 
+    iterations = workers[0].iterations;
+    *omega = workers[0].omega;
+    pthread_barrier_destroy(&barrier);
+    free(deltas);
+    free(workers);
+    free(threads);
     return iterations;
 }
 
@@ -166,20 +5318,59 @@ int main(int argc, char **argv)
     double top = 1;
     double bottom = 3;
     bool debug = false;
+    bool mixed = false;
+    bool lagged = false;
+    bool blocks = false;
+    int deep = 0;
+    int haloMode = HALO_P2P;
+    int balanceInterval = 0;
+    Balance balance;
+    bool async = false;
+    bool pipeline = false;
+    bool hierarchical = false;
+    CartBlock block;
+    int kernel = KERNEL_GS;
+    int depth = 1;
+    int checkInterval = 1;
+    int numThreads = 1;
+    int method = METHOD_RELAX;
+    int omegaMode = OMEGA_GRID;
+    double omega = 1;
+    OmegaEstimate omegaEstimate;
 
-    int world_rank, world_size;
+    int world_rank, world_size, provided;
 
     // For timing algorithm
     struct timespec start, end;
 
     double** subPlane;
+    double** nextSubPlane = NULL;
 
     unsigned long iterations;
 
     int opt;
+    const struct option longOptions[] = {
+        {"kernel", required_argument, NULL, 'k'},
+        {"block", required_argument, NULL, 'b'},
+        {"check", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"method", required_argument, NULL, 'm'},
+        {"omega", required_argument, NULL, 'w'},
+        {"mixed", no_argument, NULL, 'f'},
+        {"lagged", no_argument, NULL, 'g'},
+        {"blocks", no_argument, NULL, 'q'},
+        {"deep", required_argument, NULL, 'e'},
+        {"halo", required_argument, NULL, 'a'},
+        {"balance", required_argument, NULL, 'z'},
+        {"async", no_argument, NULL, 'y'},
+        {"pipeline", no_argument, NULL, 'v'},
+        {"hierarchical", no_argument, NULL, 'j'},
+        {NULL, 0, NULL, 0}
+    };
 
     // Parse any command line flags
-    while ((opt = getopt (argc, argv, "u:d:l:r:s:p:h:x")) != -1)
+    while ((opt = getopt_long (argc, argv,
+        "u:d:l:r:s:p:k:b:c:t:m:w:h:e:a:z:xfgqyvj", longOptions, NULL)) != -1)
         switch (opt) {
             case 'u':
                 top = atof(optarg);
@@ -199,6 +5390,37 @@ int main(int argc, char **argv)
             case 'p':
                 tolerance = atof(optarg);
                 break;
+            case 'k':
+                kernel = parseKernel(optarg);
+                if(kernel < 0) {
+                    fprintf (stderr, "Unknown kernel `%s'.\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                depth = atoi(optarg);
+                break;
+            case 'c':
+                checkInterval = parseCheck(optarg);
+                break;
+            case 't':
+                numThreads = atoi(optarg);
+                break;
+            case 'm':
+                method = parseMethod(optarg);
+                if(method < 0) {
+                    fprintf (stderr, "Unknown method `%s'.\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'w':
+                omegaMode = parseOmega(optarg, &omega);
+                if(omegaMode < 0) {
+                    fprintf (stderr, "Omega must be between 0 and 2, grid or "
+                        "estimate\n");
+                    return 1;
+                }
+                break;
             case 'h':
                 // TODO print help stuff
                 printf("TODO help info\n");
@@ -206,6 +5428,37 @@ int main(int argc, char **argv)
             case 'x':
                 debug = true;
                 break;
+            case 'f':
+                mixed = true;
+                break;
+            case 'g':
+                lagged = true;
+                break;
+            case 'q':
+                blocks = true;
+                break;
+            case 'e':
+                deep = atoi(optarg);
+                break;
+            case 'z':
+                balanceInterval = atoi(optarg);
+                break;
+            case 'y':
+                async = true;
+                break;
+            case 'v':
+                pipeline = true;
+                break;
+            case 'j':
+                hierarchical = true;
+                break;
+            case 'a':
+                haloMode = parseHalo(optarg);
+                if(haloMode < 0) {
+                    fprintf (stderr, "Unknown halo exchange `%s'.\n", optarg);
+                    return 1;
+                }
+                break;
             case '?':
                 fprintf (stderr, "Unknown option character `\\x%x'.\n", optopt);
                 return 1;
@@ -219,40 +5472,297 @@ int main(int argc, char **argv)
         fprintf (stderr, "The size of the plane must be greater than 2\n");
         return 1;
     }
+    // At least one sweep must be done between each convergence check
+    if(depth < 1) {
+        fprintf (stderr, "The number of sweeps per block must be at least 1\n");
+        return 1;
+    }
+    // Convergence must be checked at some point
+    if(checkInterval == 0) {
+        fprintf (stderr, "The number of iterations between checks must be at "
+            "least 1, or adaptive\n");
+        return 1;
+    }
+    // Must have at least one thread per process
+    if(numThreads < 1) {
+        fprintf (stderr, "The number of threads must be at least 1\n");
+        return 1;
+    }
+    // Temporal blocking is only done with a single thread per process
+    if(numThreads > 1 && depth > 1) {
+        fprintf (stderr, "More than one sweep per block needs a single "
+            "thread\n");
+        return 1;
+    }
+    // The threads check for convergence at every barrier anyway
+    if(numThreads > 1 && checkInterval != 1) {
+        fprintf (stderr, "Checking less often than every iteration needs a "
+            "single thread\n");
+        return 1;
+    }
+    // SOR and the multigrid smoother are only done with red-black ordering
+    if((method == METHOD_SOR || method == METHOD_MG) && kernel == KERNEL_GS)
+        kernel = KERNEL_RB;
+    // Only relax and sor can use more threads or more sweeps at a time
+    if(method != METHOD_RELAX && method != METHOD_SOR &&
+        (numThreads > 1 || depth > 1))
+    {
+        fprintf (stderr, "The %s method needs a single thread and one sweep "
+            "per block\n", methodName((Method)method));
+        return 1;
+    }
+    // Only single threaded relax and sor have float sweeps
+    if(mixed && ((method != METHOD_RELAX && method != METHOD_SOR) ||
+        numThreads > 1 || depth > 1))
+    {
+        fprintf (stderr, "Mixed precision needs the relax or sor method, a "
+            "single thread and one sweep per block\n");
+        return 1;
+    }
+    // Only single threaded relax and sor reduce the change from each sweep
+    if(lagged && ((method != METHOD_RELAX && method != METHOD_SOR) ||
+        numThreads > 1))
+    {
+        fprintf (stderr, "Lagged checks need the relax or sor method and a "
+            "single thread\n");
+        return 1;
+    }
+    // Only plain single threaded relax and sor are split into 2D blocks
+    if(blocks && ((method != METHOD_RELAX && method != METHOD_SOR) ||
+        numThreads > 1 || depth > 1 || mixed || lagged))
+    {
+        fprintf (stderr, "2D blocks need the relax or sor method, a single "
+            "thread and one sweep per block, without -f or -g\n");
+        return 1;
+    }
+    // Deep halos replace the other ways of relaxing with relax and sor
+    if(deep < 0 || (deep > 0 && ((method != METHOD_RELAX &&
+        method != METHOD_SOR) || numThreads > 1 || depth > 1 || mixed ||
+        lagged || blocks || checkInterval != 1)))
+    {
+        fprintf (stderr, "Deep halos need a number of sweeps, the relax or "
+            "sor method, a single thread and one sweep per block, without "
+            "-c, -f, -g or -q\n");
+        return 1;
+    }
+    // Only the single threaded relax and sor swaps are done other ways
+    if(haloMode != HALO_P2P && ((method != METHOD_RELAX &&
+        method != METHOD_SOR) || numThreads > 1 || blocks || deep > 0))
+    {
+        fprintf (stderr, "The %s halo exchange needs the relax or sor method "
+            "and a single thread, without -q or -e\n",
+            haloName((HaloMode)haloMode));
+        return 1;
+    }
+    // Rows are only moved between processes by plain relax and sor
+    if(balanceInterval < 0 || (balanceInterval > 0 && ((method !=
+        METHOD_RELAX && method != METHOD_SOR) || numThreads > 1 || mixed ||
+        blocks || deep > 0)))
+    {
+        fprintf (stderr, "Load balancing needs a number of sweeps, the relax "
+            "or sor method and a single thread, without -f, -q or -e\n");
+        return 1;
+    }
+    /* Asynchronous relaxation has no blocks, checks or swaps to set up.
+        Over-relaxing against edge rows many sweeps old can diverge, so only
+        plain relaxation is done this way */
+    if(async && (method != METHOD_RELAX || numThreads > 1 || depth > 1 ||
+        checkInterval != 1 || mixed || lagged || blocks || deep > 0 ||
+        haloMode != HALO_P2P || balanceInterval > 0))
+    {
+        fprintf (stderr, "Asynchronous relaxation needs the relax method, a "
+            "single thread and one sweep per block, without -c, -f, -g, -q, "
+            "-e, -a or -z\n");
+        return 1;
+    }
+    // The pipeline keeps Gauss-Seidel order across the processes
+    if(pipeline && (method != METHOD_RELAX || kernel != KERNEL_GS ||
+        numThreads > 1 || depth > 1 || checkInterval != 1 || mixed ||
+        lagged || blocks || deep > 0 || haloMode != HALO_P2P ||
+        balanceInterval > 0 || async))
+    {
+        fprintf (stderr, "The pipeline needs the relax method, the gs "
+            "kernel, a single thread and one sweep per block, without -c, "
+            "-f, -g, -q, -e, -a, -z or -y\n");
+        return 1;
+    }
+    // Only the checks made by plain relax and sor are reduced in two levels
+    if(hierarchical && ((method != METHOD_RELAX && method != METHOD_SOR) ||
+        numThreads > 1 || mixed || lagged || blocks || deep > 0 || async ||
+        pipeline))
+    {
+        fprintf (stderr, "Hierarchical reduction needs the relax or sor "
+            "method and a single thread, without -f, -g, -q, -e, -y or -v\n");
+        return 1;
+    }
+    // Shared edge rows change under a sweep unless it is one colour at a time
+    if(haloMode == HALO_SHARED && depth > 1) {
+        fprintf (stderr, "The shared halo exchange needs one sweep per "
+            "block\n");
+        return 1;
+    }
     // Tolerance must be greater than 0
     if(tolerance < 0) {
         fprintf (stderr, "The tolerance must be greater than 0\n");
         return 1;
     }
 
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    // Pick the kernel this CPU can run
+    if(resolveKernel((Kernel)kernel) < 0) {
+        fprintf (stderr, "The %s kernel is not supported on this CPU\n",
+            kernelName((Kernel)kernel));
+        return 1;
+    }
+    kernel = resolveKernel((Kernel)kernel);
+    /* Gauss-Seidel order is not well defined across threads, across the
+        rows relaxed by more than one process, or across rows read in place
+        while their process relaxes them, so use red-black */
+    if((numThreads > 1 || deep > 0 || haloMode == HALO_SHARED) &&
+        kernel == KERNEL_GS)
+        kernel = KERNEL_RB;
+
+    // Only the main thread of each process makes MPI calls
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    planeComm = newPlaneComm();
+    MPI_Comm_rank(planeComm, &world_rank);
+    MPI_Comm_size(planeComm, &world_size);
+    if(numThreads > 1 && provided < MPI_THREAD_FUNNELED) {
+        if(!world_rank)
+            fprintf (stderr, "This MPI library does not support threads\n");
+        MPI_Finalize();
+        return 1;
+    }
 
     int sizeOfInner = sizeOfPlane-2;
     int rowsPerThreadS = sizeOfInner/world_size+1;
     int rowsPerThreadE = sizeOfInner/world_size;
     int remainingRows = sizeOfInner - world_size * rowsPerThreadE;
 
-    int numRows;
+    int numRows, firstRow;
+    // Rows held above and below this process's own rows
+    int topHalo = 1;
+    int bottomHalo = 1;
+
+    if(blocks) {
+        block = newCartBlock(sizeOfPlane, world_size);
+        if(block.comm == MPI_COMM_NULL) {
+            if(!world_rank)
+                fprintf (stderr, "The plane is too small to split into %d "
+                    "x %d blocks\n", block.dims[0], block.dims[1]);
+            MPI_Finalize();
+            return 1;
+        }
+    } else if(world_size > sizeOfInner) {
+        // Every process needs at least one row of its own
+        if(!world_rank)
+            fprintf (stderr, "The plane is too small to split into %d rows\n",
+                world_size);
+        MPI_Finalize();
+        return 1;
+    }
 
     if(world_rank < remainingRows) {
         numRows = rowsPerThreadS + 2;
     } else {
         numRows = rowsPerThreadE + 2;
     }
+    // Index in the whole plane of the top edge row this process holds
+    firstRow = world_rank * rowsPerThreadE
+        + (world_rank < remainingRows ? world_rank : remainingRows);
+
+    if(deep > 0) {
+        // The rows held from a neighbour must all be that neighbour's own
+        if(rowsPerThreadE < 2 * deep) {
+            if(!world_rank)
+                fprintf (stderr, "Deep halos of %d sweeps need at least %d "
+                    "rows per process\n", deep, 2 * deep);
+            MPI_Finalize();
+            return 1;
+        }
+        topHalo = world_rank > 0 ? 2 * deep : 1;
+        bottomHalo = world_rank < world_size-1 ? 2 * deep : 1;
+        numRows += topHalo + bottomHalo - 2;
+        firstRow -= topHalo - 1;
+    }
+
+    // Only the sor method over-relaxes
+    omegaEstimate = newOmegaEstimate(method == METHOD_SOR ?
+        (OmegaMode)omegaMode : OMEGA_FIXED, omega, sizeOfPlane);
 
     // Create new 2D array and populate 2D array with initial values
-    subPlane = newSubPlane((unsigned int)sizeOfPlane, (unsigned int)numRows);
-    populateSubPlane(subPlane, sizeOfPlane, numRows, top, bottom, left, right,
-        world_rank, world_size);
+    if(blocks) {
+        subPlane = newSubPlane((unsigned int)block.numCols,
+            (unsigned int)block.numRows);
+        populateBlock(subPlane, block.numRows, block.numCols, block.firstRow,
+            block.firstCol, sizeOfPlane, top, bottom, left, right);
+    } else {
+        subPlane = newSubPlane((unsigned int)sizeOfPlane,
+            (unsigned int)numRows);
+        populateSubPlane(subPlane, sizeOfPlane, numRows, top, bottom, left,
+            right, world_rank, world_size);
+    }
+    // Jacobi iteration needs a second array to write each iteration into
+    if(method == METHOD_JACOBI || method == METHOD_CHEBYSHEV) {
+        nextSubPlane = newSubPlane((unsigned int)sizeOfPlane,
+            (unsigned int)numRows);
+        populateSubPlane(nextSubPlane, sizeOfPlane, numRows, top, bottom,
+            left, right, world_rank, world_size);
+    }
 
     // Start timer 
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     // Run relaxation algorithm
-    iterations = relaxPlane(subPlane, numRows, sizeOfPlane, tolerance,
-        world_rank, world_size);
+    if(blocks) {
+        iterations = relaxBlockPlane(subPlane, &block, tolerance,
+            (Kernel)kernel, checkInterval, &omegaEstimate);
+    } else if(method == METHOD_JACOBI) {
+        iterations = jacobiPlane(subPlane, nextSubPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size, (Kernel)kernel);
+    } else if(method == METHOD_CHEBYSHEV) {
+        iterations = chebyshevPlane(subPlane, nextSubPlane, numRows,
+            sizeOfPlane, tolerance, world_rank, world_size, checkInterval);
+    } else if(method == METHOD_MG) {
+        iterations = multigridPlane(subPlane, numRows, sizeOfPlane, tolerance,
+            world_rank, world_size, firstRow, (Kernel)kernel);
+    } else if(method == METHOD_DST) {
+        iterations = dstPlane(subPlane, numRows, sizeOfPlane, world_rank,
+            world_size, firstRow);
+    } else if(method == METHOD_CG) {
+        iterations = conjugateGradientPlane(subPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size);
+    } else if(method == METHOD_PIPECG) {
+        iterations = pipelinedCGPlane(subPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size);
+    } else if(numThreads > 1) {
+        iterations = relaxPlaneThreaded(subPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size, firstRow, (Kernel)kernel,
+            numThreads, &omegaEstimate);
+    } else if(deep > 0) {
+        iterations = relaxPlaneDeep(subPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size, firstRow, (Kernel)kernel, deep,
+            &omegaEstimate);
+    } else if(pipeline) {
+        iterations = pipelinedRelaxPlane(subPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size);
+    } else if(async) {
+        iterations = asyncRelaxPlane(subPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size, firstRow, (Kernel)kernel);
+    } else if(mixed) {
+        iterations = mixedRelaxPlane(subPlane, numRows, sizeOfPlane,
+            tolerance, world_rank, world_size, firstRow, (Kernel)kernel,
+            checkInterval, lagged, (HaloMode)haloMode, &omegaEstimate);
+    } else {
+        if(balanceInterval > 0)
+            balance = newBalance(&subPlane, &numRows, &firstRow,
+                balanceInterval, sizeOfPlane, world_size);
+        iterations = relaxPlane(subPlane, numRows, sizeOfPlane, tolerance,
+            world_rank, world_size, firstRow, (Kernel)kernel, depth,
+            checkInterval, lagged, (HaloMode)haloMode, &omegaEstimate,
+            balanceInterval > 0 ? &balance : NULL, hierarchical);
+        if(balanceInterval > 0)
+            free(balance.bounds);
+    }
 
     // End Timer
     clock_gettime(CLOCK_MONOTONIC, &end);
@@ -265,7 +5775,30 @@ int main(int argc, char **argv)
             and problem size that the results came from */
         asprintf(&file_name, "%d-%d.result", world_size, sizeOfPlane);
 
-        for(int i=0; i<world_size; i++) {
+        // The blocks are put back together on one process to write out
+        if(blocks) {
+            double** whole = NULL;
+            if(block.rank == 0) {
+                whole = newSubPlane((unsigned int)sizeOfPlane,
+                    (unsigned int)sizeOfPlane);
+                populateBlock(whole, sizeOfPlane, sizeOfPlane, 0, 0,
+                    sizeOfPlane, top, bottom, left, right);
+            }
+            gatherBlocks(subPlane, &block, whole, sizeOfPlane);
+            if(block.rank == 0) {
+                file = fopen(file_name, "w");
+                for(int j=0; j<sizeOfPlane; j++) {
+                    for(int k=0; k<sizeOfPlane; k++)
+                        fprintf(file, "%f, ", whole[j][k]);
+                    fprintf(file, "\n");
+                }
+                fclose(file);
+                freePlane(whole);
+            }
+            MPI_Barrier(planeComm);
+        }
+
+        for(int i=0; !blocks && i<world_size; i++) {
             // If it is this processes turn, write out to the file
             if (i == world_rank) {
                 /* If this is world_rank 0 then create a new file,
@@ -273,15 +5806,16 @@ int main(int argc, char **argv)
                 file = fopen(file_name, world_rank == 0 ? "w" : "a");
                 
                 /* Unless this is the first or last MPI process, do not write
-                    out the first or last line of the array */
-                int startingRow = 1;
-                int endingRow = numRows - 1;
+                    out the rows held from the processes above and below */
+                int startingRow = topHalo;
+                int endingRow = numRows - bottomHalo;
                 
                 /* If this is the first or last MPI process, then also write out
                     the first or last line of the array respecively */
                 if(world_rank == 0) {
                     startingRow = 0;
-                } else if(world_rank == world_size-1) {
+                }
+                if(world_rank == world_size-1) {
                     endingRow = numRows;
                 }
                 // Write out data from the array
@@ -293,7 +5827,7 @@ int main(int argc, char **argv)
                 fclose(file);
             }
             // Wait for MPI process that is writing to file
-            MPI_Barrier(MPI_COMM_WORLD);
+            MPI_Barrier(planeComm);
         }
         // Additional information about how the program ran
         if(!world_rank) {
@@ -306,11 +5840,37 @@ int main(int argc, char **argv)
         }
     }
 
+    if(blocks)
+        MPI_Comm_free(&block.comm);
+    MPI_Comm_free(&planeComm);
     MPI_Finalize();
 
     // Print out some information about how the program ran to stdout 
     if(!world_rank) {
         printf("Threads: %d\n",world_size);
+        printf("Threads per process: %d\n", numThreads);
+        printf("Method: %s\n", methodName((Method)method));
+        printf("Kernel: %s\n", kernelName((Kernel)kernel));
+        if(method == METHOD_SOR)
+            printf("Omega: %f\n", omegaEstimate.omega);
+        if(mixed)
+            printf("Precision: mixed\n");
+        if(lagged)
+            printf("Checks: lagged\n");
+        if(blocks)
+            printf("Blocks: %d x %d\n", block.dims[0], block.dims[1]);
+        if(deep > 0)
+            printf("Sweeps per swap: %d\n", deep);
+        if(haloMode != HALO_P2P)
+            printf("Halo exchange: %s\n", haloName((HaloMode)haloMode));
+        if(balanceInterval > 0)
+            printf("Sweeps per balance: %d\n", balanceInterval);
+        if(async)
+            printf("Relaxation: asynchronous\n");
+        if(pipeline)
+            printf("Relaxation: pipelined\n");
+        if(hierarchical)
+            printf("Reduction: hierarchical\n");
         printf("Size of Pane: %d\n", sizeOfPlane);
         printf("Iterations: %lu\n", iterations);
         printf("Time: %Lfs\n", toSeconds(start, end));
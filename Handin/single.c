@@ -1,129 +1,3100 @@
 #include <stdio.h>
 #include <math.h>
+#include <complex.h>
+#include <float.h>
 #include <time.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+/**
+ * @brief The inner loop used to relax each row of the plane. Every kernel
+ *         apart from KERNEL_GS uses red-black ordering
+ */
+typedef enum {
+    KERNEL_GS,
+    KERNEL_RB,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    KERNEL_SIMD
+} Kernel;
+
+/**
+ * @brief Largest change made by a thread in one iteration, padded out to a
+ *         cache line so no two threads ever write to the same line
+ */
+typedef struct {
+    double maxDelta;
+    char padding[64 - sizeof(double)];
+} ThreadDelta;
+
+/**
+ * @brief Relaxes part of a single row, returning the largest absolute change
+ *         made to any cell
+ */
+typedef double (*RowKernel)(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega);
+
+/**
+ * @brief Relaxes part of a single row without finding the changes made, for
+ *         the sweeps between convergence checks
+ */
+typedef void (*UncheckedRowKernel)(const double* restrict above,
+    double* restrict row, const double* restrict below, int start, int end,
+    double omega);
+
+/**
+ * @brief Relaxes part of a single row stored as floats, returning the largest
+ *         absolute change made to any cell
+ */
+typedef float (*FloatRowKernel)(const float* restrict above,
+    float* restrict row, const float* restrict below, int start, int end,
+    float omega);
+
+/**
+ * @brief Calculates the next Jacobi iterate of part of a row, returning the
+ *         largest absolute change made to any cell
+ */
+typedef double (*JacobiRowKernel)(const double* restrict above,
+    const double* restrict row, const double* restrict below,
+    double* restrict out, int start, int end, bool stream);
+
+/**
+ * @brief The algorithm used to solve the plane
+ */
+typedef enum {
+    METHOD_RELAX,
+    METHOD_JACOBI,
+    METHOD_SOR,
+    METHOD_MG,
+    METHOD_CG,
+    METHOD_PIPECG,
+    METHOD_CHEBYSHEV,
+    METHOD_DST
+} Method;
+
+/**
+ * @brief How the over-relaxation factor of the sor method is chosen
+ */
+typedef enum {
+    OMEGA_FIXED,
+    OMEGA_GRID,
+    OMEGA_ESTIMATE
+} OmegaMode;
+
+/**
+ * @brief The over-relaxation factor in use, and what is needed to estimate a
+ *         better one from how quickly the plane is converging
+ */
+typedef struct {
+    double omega;
+    // Whether omega may be other than 1, which needs the over-relaxed kernels
+    bool over;
+    bool estimating;
+    // Optimum for the 5-point Laplacian, which the estimate may not pass
+    double limit;
+    double lastDelta;
+    double lastRatio;
+    unsigned long samples;
+} OmegaEstimate;
+
+// Iterations to wait after changing omega before measuring the decay again
+#define OMEGA_MIN_SAMPLES 10
+// Relative change below which the decay or omega is considered settled
+#define OMEGA_SETTLED 0.01
+
+/**
+ * @brief How many iterations to do before the next convergence check. With
+ *         -c adaptive this follows how quickly the plane is converging
+ */
+typedef struct {
+    int interval;
+    bool adaptive;
+    double lastDelta;
+} CheckSchedule;
+
+// Value of -c that picks the number of iterations between checks as it runs
+#define CHECK_ADAPTIVE -1
+// Most iterations done between adaptive checks, which bounds how many extra
+// iterations can be done after converging
+#define CHECK_MAX 64
+
+// Changes per sweep within this many float epsilons of the largest cell are
+// rounding noise, so the float sweeps have gone as far as they can
+#define MIXED_STALL 16
+// Over-relaxation amplifies the rounding noise, so the float sweeps have also
+// stalled once this many go by without a new smallest change
+#define MIXED_PATIENCE 64
+
+/**
+ * @brief One grid of the multigrid hierarchy. Level 0 is the plane itself,
+ *         and each level after it keeps every other row and column
+ */
+typedef struct {
+    int n;
+    double** u;
+    double** rhs;
+    double** res;
+} MultigridLevel;
+
+// Smoothing sweeps done before and after visiting the coarser level
+#define MG_SMOOTH 2
+// Sweeps used to solve the coarsest level, which is at most 4x4
+#define MG_COARSE_SWEEPS 20
+
+/**
+ * @brief Everything needed to find the discrete sine transform of rows of a
+ *         given length. The transform is found from an FFT of the row's odd
+ *         extension, which can be any even length, so that FFT is done as a
+ *         convolution with a chirp using power of two FFTs (Bluestein)
+ */
+typedef struct {
+    int length;
+    int size;
+    double complex* chirp;
+    double complex* kernel;
+    double complex* twiddle;
+    double complex* work;
+} DstPlan;
+
+/**
+ * @brief Calculates the time in seconds between two timespec structs
+ * @param start timespec struct with time less than end
+ * @param end timespec struct with time greater than start
+ * @return time difference between two struct
+ */
+long double toSeconds(struct timespec start, struct timespec end) {
+    long long difSec = end.tv_sec - start.tv_sec;
+    long long difNSec = end.tv_nsec - start.tv_nsec;
+    long long totalNS = difSec*1000000000L + difNSec;
+    return (long double) totalNS / 1000000000.0;
+}
+
+/**
+ * @brief Mallocs memory for a n*n 2D array. Memory for the array is
+ *         contiguous, with each row padded out to start on a cache line
+ * @param n the size of each side of the array
+ * @return a pointer to an array of pointers to each row in the 2D array
+ */
+double** newPlane(unsigned int n) {
+    unsigned int stride = (n + 7) & ~7u;
+    double** plane = ( double** )malloc(n * sizeof(double*));
+    plane[0] = ( double* )aligned_alloc(64, (size_t)n * stride
+        * sizeof(double));
+    for (unsigned int i = 0; i < n; ++i)
+        plane[i] = (*plane + (size_t)stride * i);
+    return plane;
+}
+
+/**
+ * @brief Mallocs memory for a n*n 2D array of floats, laid out like newPlane
+ * @param n the size of each side of the array
+ * @return a pointer to an array of pointers to each row in the 2D array
+ */
+float** newFloatPlane(unsigned int n) {
+    unsigned int stride = (n + 15) & ~15u;
+    float** plane = ( float** )malloc(n * sizeof(float*));
+    plane[0] = ( float* )aligned_alloc(64, (size_t)n * stride
+        * sizeof(float));
+    for (unsigned int i = 0; i < n; ++i)
+        plane[i] = (*plane + (size_t)stride * i);
+    return plane;
+}
+
+/**
+ * @brief Populates the plane's walls with the values provided, and sets the
+ *         centre parts to zero
+ * @param plane pointer to the 2D array
+ * @param sizeOfPlane number of rows and length of each row
+ * @param top value to put in top edge of 2D array
+ * @param bottom value to put in bottom edge of 2D array
+ * @param farLeft value to put in left edge of 2D array
+ * @param farRight value to put in right edge of 2D array
+ */
+void populatePlane(double** plane, unsigned int sizeOfPlane, double top,
+    double bottom, double farLeft, double farRight)
+{   
+    // Fill 2D array with correct values
+    for(unsigned int j=0; j<sizeOfPlane; j++) {
+        for(unsigned int i=0; i<sizeOfPlane; i++) {
+            if(i == 0) {
+                // Left
+                plane[i][j] = farLeft;
+            } else if(j == 0) {
+                // Top
+                plane[i][j] = top;
+            } else if(i == sizeOfPlane-1) {
+                // Right
+                plane[i][j] = farRight;
+            } else if(j == sizeOfPlane-1) {
+                // Bottom
+                plane[i][j] = bottom;
+            } else {
+                // Centre 
+                plane[i][j] = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Prints out a 2D array to stdout
+ * @param plane pointer to the 2D array
+ * @param sizeOfPlane number of rows and length of each row in the array
+ */
+void printPlane(double** plane, unsigned int sizeOfPlane) {
+    for(unsigned int x=0; x<sizeOfPlane; x++) {
+        for(unsigned int y=0; y<sizeOfPlane; y++) {
+            printf("%f, ", plane[x][y]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Relaxes every cell of a row from left to right (Gauss-Seidel)
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param omega unused, as plain relaxation has an omega of 1
+ * @return the largest absolute change made to any cell
+ */
+double relaxRowGS(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    double pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Relaxes every other cell of a row, i.e. the cells of one colour for
+ *         red-black ordering
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column of this colour to relax
+ * @param end column after the last one to relax
+ * @param omega unused, as plain relaxation has an omega of 1
+ * @return the largest absolute change made to any cell
+ */
+double relaxRowRB(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    double pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The SIMD kernels below never reload a cell from the row once part of it has
+ *  been stored, as an unaligned load overlapping an earlier store stalls.
+ *  Instead the neighbours to the left and right are shifted out of the
+ *  vectors already in registers. This is safe as those neighbours are always
+ *  the other colour, so are never changed during the sweep. Only the cells
+ *  of this colour are stored, so threads relaxing neighbouring rows never
+ *  write to the cells each other are reading.
+ */
+
+/**
+ * @brief SSE2 version of relaxRowRB. Pairs of cells of this colour are split
+ *         out from the cells of the other colour, relaxed, then stored back
+ *         one cell at a time
+ */
+__attribute__((target("sse2")))
+double relaxRowSSE2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    __m128d maxDelta = _mm_setzero_pd();
+    __m128d lo, hi, old, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    double lanes[2];
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        old = _mm_unpacklo_pd(lo, hi);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        maxDelta = _mm_max_pd(maxDelta,
+            _mm_andnot_pd(signMask, _mm_sub_pd(val, old)));
+        prevEast = east;
+    }
+
+    _mm_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    if(j < end) {
+        lanes[1] = relaxRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of relaxRowRB. Every lane is calculated and the cells
+ *         of the other colour are blended back to their old values, with
+ *         only the lanes of this colour being stored
+ */
+__attribute__((target("avx2")))
+double relaxRowAVX2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    __m256d maxDelta = _mm256_setzero_pd();
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    double lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm256_blend_pd(cur, _mm256_mul_pd(val, quarter), 0x5);
+        _mm256_maskstore_pd(&row[j], storeMask, val);
+        maxDelta = _mm256_max_pd(maxDelta,
+            _mm256_andnot_pd(signMask, _mm256_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = relaxRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX-512 version of relaxRowRB. Every lane is calculated and the
+ *         cells of the other colour are masked back to their old values,
+ *         with only the lanes of this colour being stored
+ */
+__attribute__((target("avx512f")))
+double relaxRowAVX512(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d maxDelta = _mm512_setzero_pd();
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    double result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_mask_blend_pd(0x55, cur, _mm512_mul_pd(val, quarter));
+        _mm512_mask_storeu_pd(&row[j], 0x55, val);
+        maxDelta = _mm512_max_pd(maxDelta,
+            _mm512_abs_pd(_mm512_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_pd(maxDelta);
+    if(j < end) {
+        tail = relaxRowRB(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+
+/**
+ * @brief Float version of relaxRowGS
+ */
+float relaxRowGSFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    float pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Float version of relaxRowRB
+ */
+float relaxRowRBFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    float pVal, delta, maxDelta = 0;
+
+    (void)omega;
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The float kernels work the same way as the double kernels above, with twice
+ *  as many cells in each vector. They are only used by one thread per plane.
+ */
+
+/**
+ * @brief SSE2 version of relaxRowRBFloat. SSE2 has no masked store, so the
+ *         cells of the other colour are stored back with their old values
+ */
+__attribute__((target("sse2")))
+float relaxRowSSE2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 colourMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+    __m128 maxDelta = _mm_setzero_ps();
+    __m128 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128 prev = _mm_set1_ps(row[start-1]);
+    float lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm_loadu_ps(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm_loadu_ps(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        tmp = _mm_shuffle_ps(prev, cur, _MM_SHUFFLE(0, 0, 3, 3));
+        west = _mm_shuffle_ps(tmp, cur, _MM_SHUFFLE(2, 1, 2, 0));
+        tmp = _mm_shuffle_ps(cur, next, _MM_SHUFFLE(0, 0, 3, 3));
+        east = _mm_shuffle_ps(cur, tmp, _MM_SHUFFLE(2, 0, 2, 1));
+        val = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(&above[j]),
+            _mm_loadu_ps(&below[j])), west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm_mul_ps(val, quarter);
+        val = _mm_or_ps(_mm_and_ps(colourMask, val),
+            _mm_andnot_ps(colourMask, cur));
+        _mm_storeu_ps(&row[j], val);
+        maxDelta = _mm_max_ps(maxDelta,
+            _mm_andnot_ps(signMask, _mm_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm_storeu_ps(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = relaxRowRBFloat(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of relaxRowRBFloat
+ */
+__attribute__((target("avx2")))
+float relaxRowAVX2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256i storeMask = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    __m256 maxDelta = _mm256_setzero_ps();
+    __m256 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256 prev = _mm256_set1_ps(row[start-1]);
+    float lanes[8], result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm256_loadu_ps(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm256_loadu_ps(&row[j+8]);
+        // Shift by one cell across the halves of the vectors
+        tmp = _mm256_permute2f128_ps(prev, cur, 0x21);
+        west = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(cur), _mm256_castps_si256(tmp), 12));
+        tmp = _mm256_permute2f128_ps(cur, next, 0x21);
+        east = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(tmp), _mm256_castps_si256(cur), 4));
+        val = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_loadu_ps(&above[j]), _mm256_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm256_blend_ps(cur, _mm256_mul_ps(val, quarter), 0x55);
+        _mm256_maskstore_ps(&row[j], storeMask, val);
+        maxDelta = _mm256_max_ps(maxDelta,
+            _mm256_andnot_ps(signMask, _mm256_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_ps(lanes, maxDelta);
+    result = lanes[0];
+    for(int k=1; k<8; k++)
+        result = lanes[k] > result ? lanes[k] : result;
+    if(j < end) {
+        tail = relaxRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+
+/**
+ * @brief AVX-512 version of relaxRowRBFloat
+ */
+__attribute__((target("avx512f")))
+float relaxRowAVX512Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m512 quarter = _mm512_set1_ps(0.25f);
+    const __m512i westIdx = _mm512_set_epi32(30, 29, 28, 27, 26, 25, 24, 23,
+        22, 21, 20, 19, 18, 17, 16, 15);
+    const __m512i eastIdx = _mm512_set_epi32(16, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1);
+    __m512 maxDelta = _mm512_setzero_ps();
+    __m512 cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512 prev = _mm512_set1_ps(row[start-1]);
+    float result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+31
+    if(j+31 < end)
+        cur = _mm512_loadu_ps(&row[j]);
+    for(; j+31<end; j+=16) {
+        next = _mm512_loadu_ps(&row[j+16]);
+        west = _mm512_permutex2var_ps(prev, westIdx, cur);
+        east = _mm512_permutex2var_ps(cur, eastIdx, next);
+        val = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(
+            _mm512_loadu_ps(&above[j]), _mm512_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_mask_blend_ps(0x5555, cur, _mm512_mul_ps(val, quarter));
+        _mm512_mask_storeu_ps(&row[j], 0x5555, val);
+        maxDelta = _mm512_max_ps(maxDelta,
+            _mm512_abs_ps(_mm512_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_ps(maxDelta);
+    if(j < end) {
+        tail = relaxRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+
+/*
+ * The over-relaxed kernels are kept apart from the plain ones, which they
+ *  would otherwise slow down. They are built without fused multiply-adds,
+ *  which would round the blend differently in the kernels that can use them.
+ */
+
+/**
+ * @brief Over-relaxes every cell of a row from left to right, moving each
+ *         cell omega times as far as relaxRowGS would (SOR)
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param omega over-relaxation factor
+ * @return the largest absolute change made to any cell
+ */
+__attribute__((optimize("fp-contract=off")))
+double sorRowGS(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+    double pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Over-relaxes every other cell of a row, moving each cell omega
+ *         times as far as relaxRowRB would
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param start first column of this colour to relax
+ * @param end column after the last one to relax
+ * @param omega over-relaxation factor
+ * @return the largest absolute change made to any cell
+ */
+__attribute__((optimize("fp-contract=off")))
+double sorRowRB(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+    double pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabs(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/**
+ * @brief SSE2 version of sorRowRB. Pairs of cells of this colour are split
+ *         out from the cells of the other colour, relaxed, then stored back
+ *         one cell at a time
+ */
+__attribute__((target("sse2"), optimize("fp-contract=off")))
+double sorRowSSE2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    const __m128d vOmega = _mm_set1_pd(omega);
+    const __m128d vRest = _mm_set1_pd(1 - omega);
+    __m128d maxDelta = _mm_setzero_pd();
+    __m128d lo, hi, old, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    double lanes[2];
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        old = _mm_unpacklo_pd(lo, hi);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        val = _mm_add_pd(_mm_mul_pd(vOmega, val), _mm_mul_pd(vRest, old));
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        maxDelta = _mm_max_pd(maxDelta,
+            _mm_andnot_pd(signMask, _mm_sub_pd(val, old)));
+        prevEast = east;
+    }
+
+    _mm_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    if(j < end) {
+        lanes[1] = sorRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of sorRowRB. Every lane is calculated and the cells
+ *         of the other colour are blended back to their old values, with
+ *         only the lanes of this colour being stored
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+double sorRowAVX2(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    const __m256d vOmega = _mm256_set1_pd(omega);
+    const __m256d vRest = _mm256_set1_pd(1 - omega);
+    __m256d maxDelta = _mm256_setzero_pd();
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    double lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm256_add_pd(_mm256_mul_pd(vOmega, _mm256_mul_pd(val, quarter)),
+            _mm256_mul_pd(vRest, cur));
+        val = _mm256_blend_pd(cur, val, 0x5);
+        _mm256_maskstore_pd(&row[j], storeMask, val);
+        maxDelta = _mm256_max_pd(maxDelta,
+            _mm256_andnot_pd(signMask, _mm256_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = sorRowRB(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX-512 version of sorRowRB. Every lane is calculated and the
+ *         cells of the other colour are masked back to their old values,
+ *         with only the lanes of this colour being stored
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+double sorRowAVX512(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512d vOmega = _mm512_set1_pd(omega);
+    const __m512d vRest = _mm512_set1_pd(1 - omega);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d maxDelta = _mm512_setzero_pd();
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    double result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_add_pd(_mm512_mul_pd(vOmega, _mm512_mul_pd(val, quarter)),
+            _mm512_mul_pd(vRest, cur));
+        val = _mm512_mask_blend_pd(0x55, cur, val);
+        _mm512_mask_storeu_pd(&row[j], 0x55, val);
+        maxDelta = _mm512_max_pd(maxDelta,
+            _mm512_abs_pd(_mm512_sub_pd(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_pd(maxDelta);
+    if(j < end) {
+        tail = sorRowRB(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+/*
+ * The unchecked kernels below are for the sweeps between convergence checks.
+ *  They make the same changes as the kernels above, but do not find how large
+ *  those changes are, which leaves each loop as just the stencil and stores.
+ */
+
+/**
+ * @brief Version of relaxRowGS that does not find the change made
+ */
+void relaxRowGSUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    (void)omega;
+    for(int j=start; j<end; j++)
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+}
+
+/**
+ * @brief Version of relaxRowRB that does not find the change made
+ */
+void relaxRowRBUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    (void)omega;
+    for(int j=start; j<end; j+=2)
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+}
+
+/**
+ * @brief Version of sorRowGS that does not find the change made
+ */
+__attribute__((optimize("fp-contract=off")))
+void sorRowGSUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+
+    for(int j=start; j<end; j++)
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*row[j];
+}
+
+/**
+ * @brief Version of sorRowRB that does not find the change made
+ */
+__attribute__((optimize("fp-contract=off")))
+void sorRowRBUnchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const double rest = 1 - omega;
+
+    for(int j=start; j<end; j+=2)
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*row[j];
+}
+
+#ifdef HAVE_X86_SIMD
+/**
+ * @brief Version of relaxRowSSE2 that does not find the change made
+ */
+__attribute__((target("sse2")))
+void relaxRowSSE2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    __m128d lo, hi, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        prevEast = east;
+    }
+
+    if(j < end)
+        relaxRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of relaxRowAVX2 that does not find the change made. Only
+ *         the lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx2")))
+void relaxRowAVX2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        _mm256_maskstore_pd(&row[j], storeMask, _mm256_mul_pd(val, quarter));
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        relaxRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of relaxRowAVX512 that does not find the change made. Only
+ *         the lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx512f")))
+void relaxRowAVX512Unchecked(const double* restrict above,
+    double* restrict row, const double* restrict below, int start, int end,
+    double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        _mm512_mask_storeu_pd(&row[j], 0x55, _mm512_mul_pd(val, quarter));
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        relaxRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of sorRowSSE2 that does not find the change made
+ */
+__attribute__((target("sse2"), optimize("fp-contract=off")))
+void sorRowSSE2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d vOmega = _mm_set1_pd(omega);
+    const __m128d vRest = _mm_set1_pd(1 - omega);
+    __m128d lo, hi, old, west, east, vAbove, vBelow, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128d prevEast = _mm_set_pd(row[start-1], 0);
+    int j;
+
+    for(j=start; j+3<end; j+=4) {
+        // Cells j and j+2 are relaxed, j+1 and j+3 are left untouched
+        lo = _mm_loadu_pd(&row[j]);
+        hi = _mm_loadu_pd(&row[j+2]);
+        old = _mm_unpacklo_pd(lo, hi);
+        east = _mm_unpackhi_pd(lo, hi);
+        west = _mm_shuffle_pd(prevEast, east, 1);
+        vAbove = _mm_unpacklo_pd(_mm_loadu_pd(&above[j]),
+            _mm_loadu_pd(&above[j+2]));
+        vBelow = _mm_unpacklo_pd(_mm_loadu_pd(&below[j]),
+            _mm_loadu_pd(&below[j+2]));
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(vAbove, vBelow),
+            west), east), quarter);
+        val = _mm_add_pd(_mm_mul_pd(vOmega, val), _mm_mul_pd(vRest, old));
+        _mm_storel_pd(&row[j], val);
+        _mm_storeh_pd(&row[j+2], val);
+        prevEast = east;
+    }
+
+    if(j < end)
+        sorRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of sorRowAVX2 that does not find the change made. Only the
+ *         lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+void sorRowAVX2Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256i storeMask = _mm256_set_epi64x(0, -1, 0, -1);
+    const __m256d vOmega = _mm256_set1_pd(omega);
+    const __m256d vRest = _mm256_set1_pd(1 - omega);
+    __m256d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256d prev = _mm256_set_pd(row[start-1], 0, 0, 0);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm256_loadu_pd(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm256_loadu_pd(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        west = _mm256_shuffle_pd(_mm256_permute2f128_pd(prev, cur, 0x21),
+            cur, 0x5);
+        east = _mm256_shuffle_pd(cur,
+            _mm256_permute2f128_pd(cur, next, 0x21), 0x5);
+        val = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            west), east);
+        val = _mm256_add_pd(_mm256_mul_pd(vOmega, _mm256_mul_pd(val, quarter)),
+            _mm256_mul_pd(vRest, cur));
+        _mm256_maskstore_pd(&row[j], storeMask, val);
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        sorRowRBUnchecked(above, row, below, j, end, omega);
+}
+
+/**
+ * @brief Version of sorRowAVX512 that does not find the change made. Only
+ *         the lanes of this colour are stored, so the others need no blend
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+void sorRowAVX512Unchecked(const double* restrict above, double* restrict row,
+    const double* restrict below, int start, int end, double omega)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512d vOmega = _mm512_set1_pd(omega);
+    const __m512d vRest = _mm512_set1_pd(1 - omega);
+    const __m512i westIdx = _mm512_set_epi64(14, 13, 12, 11, 10, 9, 8, 7);
+    const __m512i eastIdx = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+    __m512d cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512d prev = _mm512_set1_pd(row[start-1]);
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm512_loadu_pd(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm512_loadu_pd(&row[j+8]);
+        west = _mm512_permutex2var_pd(prev, westIdx, cur);
+        east = _mm512_permutex2var_pd(cur, eastIdx, next);
+        val = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            west), east);
+        val = _mm512_add_pd(_mm512_mul_pd(vOmega, _mm512_mul_pd(val, quarter)),
+            _mm512_mul_pd(vRest, cur));
+        _mm512_mask_storeu_pd(&row[j], 0x55, val);
+        prev = cur;
+        cur = next;
+    }
+
+    if(j < end)
+        sorRowRBUnchecked(above, row, below, j, end, omega);
+}
+#endif
+
+/**
+ * @brief Float version of sorRowGS
+ */
+__attribute__((optimize("fp-contract=off")))
+float sorRowGSFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const float rest = 1 - omega;
+    float pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j++) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Float version of sorRowRB
+ */
+__attribute__((optimize("fp-contract=off")))
+float sorRowRBFloat(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const float rest = 1 - omega;
+    float pVal, delta, maxDelta = 0;
+
+    for(int j=start; j<end; j+=2) {
+        pVal = row[j];
+        row[j] = omega*((above[j] + below[j] + row[j-1] + row[j+1])/4)
+            + rest*pVal;
+        delta = fabsf(row[j]-pVal);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/**
+ * @brief SSE2 version of sorRowRBFloat. SSE2 has no masked store, so the
+ *         cells of the other colour are stored back with their old values
+ */
+__attribute__((target("sse2"), optimize("fp-contract=off")))
+float sorRowSSE2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 colourMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+    const __m128 vOmega = _mm_set1_ps(omega);
+    const __m128 vRest = _mm_set1_ps(1 - omega);
+    __m128 maxDelta = _mm_setzero_ps();
+    __m128 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m128 prev = _mm_set1_ps(row[start-1]);
+    float lanes[4], tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+7
+    if(j+7 < end)
+        cur = _mm_loadu_ps(&row[j]);
+    for(; j+7<end; j+=4) {
+        next = _mm_loadu_ps(&row[j+4]);
+        // west = [prev3, cur0, cur1, cur2], east = [cur1, cur2, cur3, next0]
+        tmp = _mm_shuffle_ps(prev, cur, _MM_SHUFFLE(0, 0, 3, 3));
+        west = _mm_shuffle_ps(tmp, cur, _MM_SHUFFLE(2, 1, 2, 0));
+        tmp = _mm_shuffle_ps(cur, next, _MM_SHUFFLE(0, 0, 3, 3));
+        east = _mm_shuffle_ps(cur, tmp, _MM_SHUFFLE(2, 0, 2, 1));
+        val = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(&above[j]),
+            _mm_loadu_ps(&below[j])), west), east);
+        // Only lanes 0 and 2 are this colour
+        val = _mm_add_ps(_mm_mul_ps(vOmega, _mm_mul_ps(val, quarter)),
+            _mm_mul_ps(vRest, cur));
+        val = _mm_or_ps(_mm_and_ps(colourMask, val),
+            _mm_andnot_ps(colourMask, cur));
+        _mm_storeu_ps(&row[j], val);
+        maxDelta = _mm_max_ps(maxDelta,
+            _mm_andnot_ps(signMask, _mm_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm_storeu_ps(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    if(j < end) {
+        tail = sorRowRBFloat(above, row, below, j, end, omega);
+        lanes[0] = lanes[0] > tail ? lanes[0] : tail;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of sorRowRBFloat
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+float sorRowAVX2Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256i storeMask = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    const __m256 vOmega = _mm256_set1_ps(omega);
+    const __m256 vRest = _mm256_set1_ps(1 - omega);
+    __m256 maxDelta = _mm256_setzero_ps();
+    __m256 cur, next, west, east, val, tmp;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m256 prev = _mm256_set1_ps(row[start-1]);
+    float lanes[8], result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+15
+    if(j+15 < end)
+        cur = _mm256_loadu_ps(&row[j]);
+    for(; j+15<end; j+=8) {
+        next = _mm256_loadu_ps(&row[j+8]);
+        // Shift by one cell across the halves of the vectors
+        tmp = _mm256_permute2f128_ps(prev, cur, 0x21);
+        west = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(cur), _mm256_castps_si256(tmp), 12));
+        tmp = _mm256_permute2f128_ps(cur, next, 0x21);
+        east = _mm256_castsi256_ps(_mm256_alignr_epi8(
+            _mm256_castps_si256(tmp), _mm256_castps_si256(cur), 4));
+        val = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_loadu_ps(&above[j]), _mm256_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm256_add_ps(_mm256_mul_ps(vOmega, _mm256_mul_ps(val, quarter)),
+            _mm256_mul_ps(vRest, cur));
+        val = _mm256_blend_ps(cur, val, 0x55);
+        _mm256_maskstore_ps(&row[j], storeMask, val);
+        maxDelta = _mm256_max_ps(maxDelta,
+            _mm256_andnot_ps(signMask, _mm256_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    _mm256_storeu_ps(lanes, maxDelta);
+    result = lanes[0];
+    for(int k=1; k<8; k++)
+        result = lanes[k] > result ? lanes[k] : result;
+    if(j < end) {
+        tail = sorRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+
+/**
+ * @brief AVX-512 version of sorRowRBFloat
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+float sorRowAVX512Float(const float* restrict above, float* restrict row,
+    const float* restrict below, int start, int end, float omega)
+{
+    const __m512 quarter = _mm512_set1_ps(0.25f);
+    const __m512 vOmega = _mm512_set1_ps(omega);
+    const __m512 vRest = _mm512_set1_ps(1 - omega);
+    const __m512i westIdx = _mm512_set_epi32(30, 29, 28, 27, 26, 25, 24, 23,
+        22, 21, 20, 19, 18, 17, 16, 15);
+    const __m512i eastIdx = _mm512_set_epi32(16, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1);
+    __m512 maxDelta = _mm512_setzero_ps();
+    __m512 cur, next, west, east, val;
+    // Only the top lane is used, as the cell left of the first one relaxed
+    __m512 prev = _mm512_set1_ps(row[start-1]);
+    float result, tail;
+    int j = start;
+
+    // The next vector is loaded a step ahead, so the row must reach j+31
+    if(j+31 < end)
+        cur = _mm512_loadu_ps(&row[j]);
+    for(; j+31<end; j+=16) {
+        next = _mm512_loadu_ps(&row[j+16]);
+        west = _mm512_permutex2var_ps(prev, westIdx, cur);
+        east = _mm512_permutex2var_ps(cur, eastIdx, next);
+        val = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(
+            _mm512_loadu_ps(&above[j]), _mm512_loadu_ps(&below[j])),
+            west), east);
+        // Only the even lanes are this colour
+        val = _mm512_add_ps(_mm512_mul_ps(vOmega, _mm512_mul_ps(val, quarter)),
+            _mm512_mul_ps(vRest, cur));
+        val = _mm512_mask_blend_ps(0x5555, cur, val);
+        _mm512_mask_storeu_ps(&row[j], 0x5555, val);
+        maxDelta = _mm512_max_ps(maxDelta,
+            _mm512_abs_ps(_mm512_sub_ps(val, cur)));
+        prev = cur;
+        cur = next;
+    }
+
+    result = _mm512_reduce_max_ps(maxDelta);
+    if(j < end) {
+        tail = sorRowRBFloat(above, row, below, j, end, omega);
+        result = result > tail ? result : tail;
+    }
+    return result;
+}
+#endif
+
+/**
+ * @brief Picks the kernel to use. KERNEL_SIMD is replaced with the widest
+ *         kernel the CPU supports
+ * @param kernel the kernel asked for
+ * @return the kernel to use, or -1 if this CPU cannot run the one asked for
+ */
+int resolveKernel(Kernel kernel) {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    switch(kernel) {
+        case KERNEL_SIMD:
+            if(__builtin_cpu_supports("avx512f"))
+                return KERNEL_AVX512;
+            if(__builtin_cpu_supports("avx2"))
+                return KERNEL_AVX2;
+            return __builtin_cpu_supports("sse2") ? KERNEL_SSE2 : KERNEL_RB;
+        case KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2") ? KERNEL_SSE2 : -1;
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? KERNEL_AVX2 : -1;
+        case KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f") ? KERNEL_AVX512 : -1;
+        default:
+            return kernel;
+    }
+#else
+    if(kernel == KERNEL_SIMD)
+        return KERNEL_RB;
+    return kernel == KERNEL_GS || kernel == KERNEL_RB ? (int)kernel : -1;
+#endif
+}
+
+/**
+ * @brief Gets the function that relaxes a row for a resolved kernel
+ * @param kernel kernel returned by resolveKernel
+ * @param over whether omega may be other than 1, so the cells need to be
+ *         over-relaxed. The plain kernels are cheaper when it never is
+ * @return pointer to the row function
+ */
+RowKernel rowKernel(Kernel kernel, bool over) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return over ? sorRowSSE2 : relaxRowSSE2;
+        case KERNEL_AVX2:
+            return over ? sorRowAVX2 : relaxRowAVX2;
+        case KERNEL_AVX512:
+            return over ? sorRowAVX512 : relaxRowAVX512;
+#endif
+        case KERNEL_GS:
+            return over ? sorRowGS : relaxRowGS;
+        default:
+            return over ? sorRowRB : relaxRowRB;
+    }
+}
+
+/**
+ * @brief Gets the function that relaxes a row for a resolved kernel without
+ *         finding the changes made
+ * @param kernel kernel returned by resolveKernel
+ * @param over whether omega may be other than 1, so the cells need to be
+ *         over-relaxed
+ * @return pointer to the row function
+ */
+UncheckedRowKernel uncheckedRowKernel(Kernel kernel, bool over) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return over ? sorRowSSE2Unchecked : relaxRowSSE2Unchecked;
+        case KERNEL_AVX2:
+            return over ? sorRowAVX2Unchecked : relaxRowAVX2Unchecked;
+        case KERNEL_AVX512:
+            return over ? sorRowAVX512Unchecked : relaxRowAVX512Unchecked;
+#endif
+        case KERNEL_GS:
+            return over ? sorRowGSUnchecked : relaxRowGSUnchecked;
+        default:
+            return over ? sorRowRBUnchecked : relaxRowRBUnchecked;
+    }
+}
+
+/**
+ * @brief Gets the function that relaxes a row of floats for a resolved kernel
+ * @param kernel kernel returned by resolveKernel
+ * @param over whether omega may be other than 1, so the cells need to be
+ *         over-relaxed. The plain kernels are cheaper when it never is
+ * @return pointer to the row function
+ */
+FloatRowKernel floatRowKernel(Kernel kernel, bool over) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return over ? sorRowSSE2Float : relaxRowSSE2Float;
+        case KERNEL_AVX2:
+            return over ? sorRowAVX2Float : relaxRowAVX2Float;
+        case KERNEL_AVX512:
+            return over ? sorRowAVX512Float : relaxRowAVX512Float;
+#endif
+        case KERNEL_GS:
+            return over ? sorRowGSFloat : relaxRowGSFloat;
+        default:
+            return over ? sorRowRBFloat : relaxRowRBFloat;
+    }
+}
+
+/**
+ * @brief Parses the name of a kernel given with -k
+ * @param name name of the kernel
+ * @return the kernel, or -1 if the name is not recognised
+ */
+int parseKernel(const char* name) {
+    const char* names[] = {"gs", "rb", "sse2", "avx2", "avx512", "simd"};
+    for(int i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++)
+        if(strcmp(name, names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief Gets the name of a kernel for printing
+ */
+const char* kernelName(Kernel kernel) {
+    const char* names[] = {"gs", "rb", "sse2", "avx2", "avx512", "simd"};
+    return names[kernel];
+}
+
+/**
+ * @brief Calculates the next Jacobi iterate of part of a row, writing it to a
+ *         separate row rather than updating the row in place
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param out row to write the new values to
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param stream true to write the new values straight to memory, skipping
+ *         the cache
+ * @return the largest absolute change made to any cell
+ */
+double jacobiRow(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    bool stream)
+{
+    double delta, maxDelta = 0;
+
+    (void)stream;
+    for(int j=start; j<end; j++) {
+        out[j] = (above[j] + below[j] + row[j-1] + row[j+1])/4;
+        delta = fabs(out[j]-row[j]);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The SIMD Jacobi kernels rely on every row of out starting on a cache line,
+ *  as newPlane and newSubPlane allocate them, so that whole vectors can be
+ *  stored with non-temporal stores once the first few cells are done.
+ */
+
+/**
+ * @brief SSE2 version of jacobiRow
+ */
+__attribute__((target("sse2")))
+double jacobiRowSSE2(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    bool stream)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    __m128d maxDelta = _mm_setzero_pd();
+    __m128d val;
+    double lanes[2], head;
+    int j = (start + 1) & ~1;
+
+    head = jacobiRow(above, row, below, out, start, j < end ? j : end, false);
+    for(; j+1<end; j+=2) {
+        val = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(
+            _mm_loadu_pd(&above[j]), _mm_loadu_pd(&below[j])),
+            _mm_loadu_pd(&row[j-1])), _mm_loadu_pd(&row[j+1])), quarter);
+        if(stream)
+            _mm_stream_pd(&out[j], val);
+        else
+            _mm_store_pd(&out[j], val);
+        maxDelta = _mm_max_pd(maxDelta,
+            _mm_andnot_pd(signMask, _mm_sub_pd(val, _mm_loadu_pd(&row[j]))));
+    }
+
+    _mm_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[0] = lanes[0] > head ? lanes[0] : head;
+    if(j < end) {
+        head = jacobiRow(above, row, below, out, j, end, false);
+        lanes[0] = lanes[0] > head ? lanes[0] : head;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX2 version of jacobiRow
+ */
+__attribute__((target("avx2")))
+double jacobiRowAVX2(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    bool stream)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    __m256d maxDelta = _mm256_setzero_pd();
+    __m256d val;
+    double lanes[4], head;
+    int j = (start + 3) & ~3;
+
+    head = jacobiRow(above, row, below, out, start, j < end ? j : end, false);
+    for(; j+3<end; j+=4) {
+        val = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+            _mm256_loadu_pd(&above[j]), _mm256_loadu_pd(&below[j])),
+            _mm256_loadu_pd(&row[j-1])), _mm256_loadu_pd(&row[j+1])),
+            quarter);
+        if(stream)
+            _mm256_stream_pd(&out[j], val);
+        else
+            _mm256_store_pd(&out[j], val);
+        maxDelta = _mm256_max_pd(maxDelta, _mm256_andnot_pd(signMask,
+            _mm256_sub_pd(val, _mm256_loadu_pd(&row[j]))));
+    }
+
+    _mm256_storeu_pd(lanes, maxDelta);
+    lanes[0] = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    lanes[2] = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    lanes[0] = lanes[0] > lanes[2] ? lanes[0] : lanes[2];
+    lanes[0] = lanes[0] > head ? lanes[0] : head;
+    if(j < end) {
+        head = jacobiRow(above, row, below, out, j, end, false);
+        lanes[0] = lanes[0] > head ? lanes[0] : head;
+    }
+    return lanes[0];
+}
+
+/**
+ * @brief AVX-512 version of jacobiRow
+ */
+__attribute__((target("avx512f")))
+double jacobiRowAVX512(const double* restrict above,
+    const double* restrict row, const double* restrict below,
+    double* restrict out, int start, int end, bool stream)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    __m512d maxDelta = _mm512_setzero_pd();
+    __m512d val;
+    double result, head;
+    int j = (start + 7) & ~7;
+
+    head = jacobiRow(above, row, below, out, start, j < end ? j : end, false);
+    for(; j+7<end; j+=8) {
+        val = _mm512_mul_pd(_mm512_add_pd(_mm512_add_pd(_mm512_add_pd(
+            _mm512_loadu_pd(&above[j]), _mm512_loadu_pd(&below[j])),
+            _mm512_loadu_pd(&row[j-1])), _mm512_loadu_pd(&row[j+1])),
+            quarter);
+        if(stream)
+            _mm512_stream_pd(&out[j], val);
+        else
+            _mm512_store_pd(&out[j], val);
+        maxDelta = _mm512_max_pd(maxDelta,
+            _mm512_abs_pd(_mm512_sub_pd(val, _mm512_loadu_pd(&row[j]))));
+    }
+
+    result = _mm512_reduce_max_pd(maxDelta);
+    result = result > head ? result : head;
+    if(j < end) {
+        head = jacobiRow(above, row, below, out, j, end, false);
+        result = result > head ? result : head;
+    }
+    return result;
+}
+#endif
+
+/**
+ * @brief Gets the function that calculates the next Jacobi iterate of a row.
+ *         The instruction set of the kernel is used, ignoring its ordering
+ * @param kernel kernel returned by resolveKernel
+ * @return pointer to the row function
+ */
+JacobiRowKernel jacobiKernel(Kernel kernel) {
+    switch(kernel) {
+#ifdef HAVE_X86_SIMD
+        case KERNEL_SSE2:
+            return jacobiRowSSE2;
+        case KERNEL_AVX2:
+            return jacobiRowAVX2;
+        case KERNEL_AVX512:
+            return jacobiRowAVX512;
+#endif
+        default:
+            return jacobiRow;
+    }
+}
+
+/**
+ * @brief Decides whether planes of a given size are too big to stay in the
+ *         last level cache between iterations, so are better written with
+ *         non-temporal stores
+ * @param bytes total size of the planes being read and written
+ * @return true if the planes should be streamed to memory
+ */
+bool shouldStream(size_t bytes) {
+    long cacheSize = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if(cacheSize <= 0)
+        cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return cacheSize > 0 && bytes > (size_t)cacheSize;
+}
+
+/**
+ * @brief Parses the name of a method given with -m
+ * @param name name of the method
+ * @return the method, or -1 if the name is not recognised
+ */
+int parseMethod(const char* name) {
+    const char* names[] = {"relax", "jacobi", "sor", "mg", "cg", "pipecg",
+        "chebyshev", "dst"};
+    for(int i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++)
+        if(strcmp(name, names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief Gets the name of a method for printing
+ */
+const char* methodName(Method method) {
+    const char* names[] = {"relax", "jacobi", "sor", "mg", "cg", "pipecg",
+        "chebyshev", "dst"};
+    return names[method];
+}
+
+/**
+ * @brief Gets the best over-relaxation factor for red-black SOR
+ * @param rhoJacobi spectral radius of Jacobi iteration on the plane
+ * @return the over-relaxation factor
+ */
+double optimalOmega(double rhoJacobi) {
+    return 2/(1 + sqrt(1 - rhoJacobi*rhoJacobi));
+}
+
+/**
+ * @brief Sets up the over-relaxation factor for a plane
+ * @param mode how the over-relaxation factor is chosen
+ * @param omega over-relaxation factor to use if mode is OMEGA_FIXED
+ * @param sizeOfPlane number of rows and length of each row in the plane
+ * @return the over-relaxation factor and the state needed to estimate it
+ */
+OmegaEstimate newOmegaEstimate(OmegaMode mode, double omega, int sizeOfPlane)
+{
+    OmegaEstimate estimate = {1, true, false, 2, 0, 0, 0};
+
+    if(mode == OMEGA_FIXED) {
+        estimate.omega = omega;
+        estimate.over = omega != 1;
+        return estimate;
+    }
+    // Jacobi's spectral radius for the 5-point Laplacian on this grid
+    estimate.limit = optimalOmega(cos(M_PI/(sizeOfPlane-1)));
+    if(mode == OMEGA_GRID) {
+        estimate.omega = estimate.limit;
+    } else {
+        // Start as Gauss-Seidel, and raise omega once the decay is measured
+        estimate.estimating = true;
+    }
+    return estimate;
+}
+
+/**
+ * @brief Updates the estimate of the best over-relaxation factor from the
+ *         largest change made in the last iteration. Once the ratio between
+ *         successive changes settles it is the spectral radius of SOR with
+ *         the current omega, from which Jacobi's spectral radius and so a
+ *         better omega can be worked out. This repeats until the new omega
+ *         stops improving, or the ratio shows omega is past its best. Close
+ *         to the optimum the decay is dominated by complex eigenvalues and
+ *         the ratio overstates Jacobi's spectral radius, so omega is held
+ *         at the grid's optimum rather than overshooting it
+ * @param estimate the estimate to update
+ * @param maxDelta largest change made by any cell in the whole plane in the
+ *         last iteration
+ */
+void updateOmega(OmegaEstimate* estimate, double maxDelta) {
+    double ratio, rhoJacobi, omega = estimate->omega;
+
+    if(!estimate->estimating)
+        return;
+
+    estimate->samples++;
+    ratio = estimate->lastDelta > 0 ? maxDelta/estimate->lastDelta : 0;
+    if(estimate->samples > OMEGA_MIN_SAMPLES && ratio < 1 &&
+        fabs(ratio - estimate->lastRatio) < OMEGA_SETTLED * (1 - ratio))
+    {
+        if(ratio > omega - 1) {
+            rhoJacobi = (ratio + omega - 1) / (omega * sqrt(ratio));
+            omega = optimalOmega(rhoJacobi < 1 ? rhoJacobi : 1);
+        }
+        // Stop once omega is no longer getting noticeably better
+        if(omega >= estimate->limit) {
+            estimate->omega = estimate->limit;
+            estimate->estimating = false;
+        } else if(omega - estimate->omega <
+            OMEGA_SETTLED * (2 - estimate->omega))
+        {
+            estimate->estimating = false;
+        } else {
+            estimate->omega = omega;
+            estimate->samples = 0;
+        }
+    }
+    estimate->lastRatio = ratio;
+    estimate->lastDelta = maxDelta;
+}
+
+/**
+ * @brief Parses the over-relaxation factor given with -w
+ * @param arg a number, "grid" or "estimate"
+ * @param omega set to the number given, if any
+ * @return how omega should be chosen, or -1 if it is not recognised
+ */
+int parseOmega(const char* arg, double* omega) {
+    char* end;
+    if(strcmp(arg, "grid") == 0)
+        return OMEGA_GRID;
+    if(strcmp(arg, "estimate") == 0)
+        return OMEGA_ESTIMATE;
+    *omega = strtod(arg, &end);
+    // SOR only converges for omega strictly between 0 and 2
+    if(*end != '\0' || *omega <= 0 || *omega >= 2)
+        return -1;
+    return OMEGA_FIXED;
+}
+
+/**
+ * @brief Parses the number of iterations between convergence checks given
+ *         with -c
+ * @param arg a number of at least 1, or "adaptive"
+ * @return the number of iterations, CHECK_ADAPTIVE, or 0 if it is not
+ *          recognised
+ */
+int parseCheck(const char* arg) {
+    char* end;
+    long interval;
+    if(strcmp(arg, "adaptive") == 0)
+        return CHECK_ADAPTIVE;
+    interval = strtol(arg, &end, 10);
+    if(*end != '\0' || interval < 1)
+        return 0;
+    return (int)interval;
+}
+
+/**
+ * @brief Sets up the schedule of convergence checks
+ * @param checkInterval number of iterations between checks, or CHECK_ADAPTIVE
+ * @return the schedule, starting with a check after the first iteration if
+ *          it is adaptive
+ */
+CheckSchedule newCheckSchedule(int checkInterval) {
+    CheckSchedule schedule = {checkInterval, false, 0};
+
+    if(checkInterval == CHECK_ADAPTIVE) {
+        schedule.interval = 1;
+        schedule.adaptive = true;
+    }
+    return schedule;
+}
+
+/**
+ * @brief Gets the most iterations that can be done between two checks
+ */
+int maxCheckInterval(const CheckSchedule* schedule) {
+    return schedule->adaptive ? CHECK_MAX : schedule->interval;
+}
+
+/**
+ * @brief Picks the number of iterations before the next adaptive check. The
+ *         decay of the change since the last check predicts how many more
+ *         iterations are needed, and the interval may double but never goes
+ *         past that, so few iterations are wasted after converging
+ * @param schedule the schedule to update
+ * @param maxDelta largest change made in the last iteration before this check
+ * @param iterations number of iterations done since the last check
+ * @param tolerance the tolerance being relaxed to
+ */
+void nextCheck(CheckSchedule* schedule, double maxDelta, int iterations,
+    double tolerance)
+{
+    double rate, remaining, interval;
+
+    if(!schedule->adaptive)
+        return;
+
+    if(schedule->lastDelta > 0 && maxDelta > 0 &&
+        maxDelta < schedule->lastDelta)
+    {
+        rate = pow(maxDelta/schedule->lastDelta, 1.0/iterations);
+        remaining = log(tolerance/maxDelta)/log(rate);
+        interval = 2.0 * schedule->interval;
+        interval = remaining < interval ? remaining : interval;
+        interval = interval < CHECK_MAX ? interval : CHECK_MAX;
+        schedule->interval = interval > 1 ? (int)interval : 1;
+    } else {
+        // Not converging yet, so check more often until it is
+        schedule->interval = schedule->interval > 1 ?
+            schedule->interval/2 : 1;
+    }
+    schedule->lastDelta = maxDelta;
+}
+
+/**
+ * @brief Gets the first column of a row that belongs to a colour, where a
+ *         cell's colour is the parity of the sum of its row and column
+ * @param row index of the row in the whole plane
+ * @param colour 0 for red, 1 for black
+ * @return the first column from 1 with that colour
+ */
+int colourStart(int row, int colour) {
+    return 1 + ((row + 1 + colour) & 1);
+}
+
+/**
+ * @brief Gets how many columns wide a tile of rows can be while it still fits
+ *         in half of the L2 cache, leaving the rest for everything else
+ * @param rows number of rows in the tile
+ * @return the number of columns, which is at least 64
+ */
+int cacheTileWidth(int rows) {
+    long cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long width;
+
+    if(cacheSize <= 0)
+        cacheSize = 256 * 1024;
+    width = cacheSize / 2 / ((long)rows * (long)sizeof(double));
+    return width > 64 ? (int)width : 64;
+}
+
+/**
+ * @brief Applies several sweeps to a block of rows in one pass down them.
+ *         Each sweep trails one row behind the sweep before it, so only the
+ *         few rows around the wavefront need to be in cache rather than the
+ *         whole plane. Rows too long for those few to fit in L2 are split into
+ *         tiles of columns, with each phase's columns shifted one to the left
+ *         of the phase before so every cell still sees its neighbours from
+ *         the right phase. Every row sees exactly the neighbours it would if
+ *         the sweeps were done one after another
+ * @param plane pointer to the 2D array
+ * @param rowStart first row to relax
+ * @param rowEnd row after the last row to relax
+ * @param sizeOfPlane length of each row in the array
+ * @param firstRow index in the whole plane of the first row in the array
+ * @param kernel resolved kernel used to relax each row
+ * @param depth number of sweeps to apply
+ * @param omega over-relaxation factor, where 1 is plain relaxation
+ * @param sweepDelta filled with the largest change made by each sweep, or
+ *         NULL if none of the sweeps are checked, so the changes are not found
+ */
+void relaxWavefront(double** plane, int rowStart, int rowEnd, int sizeOfPlane,
+    int firstRow, Kernel kernel, int depth, double omega, double* sweepDelta)
+{
+    RowKernel relaxRow = rowKernel(kernel, omega != 1);
+    UncheckedRowKernel uncheckedRow = uncheckedRowKernel(kernel, omega != 1);
+    // Red-black needs a separate pass for each colour of a sweep
+    int passes = kernel == KERNEL_GS ? 1 : 2;
+    int phases = depth * passes;
+    // The rows being relaxed by each phase, plus the ones either side
+    int width = cacheTileWidth(phases + 2);
+    int last = sizeOfPlane-1;
+    int i, p, start, end;
+    double delta;
+
+    for(p=0; p<depth && sweepDelta != NULL; p++)
+        sweepDelta[p] = 0;
+
+    // The last tile ends once the last phase has reached the end of the rows
+    for(int tile=1; tile-phases+1<last; tile+=width) {
+        for(int step=rowStart; step<rowEnd+phases-1; step++) {
+            /* Phase p relaxes row step-p. Going through the phases in order
+                means the row below has already had the previous phase
+                applied, and the row above has not yet had the next one */
+            for(p=step-rowEnd+1 > 0 ? step-rowEnd+1 : 0;
+                p<phases && step-p>=rowStart; p++)
+            {
+                i = step-p;
+                start = tile-p > 1 ? tile-p : 1;
+                end = tile+width-p < last ? tile+width-p : last;
+                if(passes == 2)
+                    start += (start - colourStart(firstRow+i, p%2)) & 1;
+                if(start >= end)
+                    continue;
+                if(sweepDelta == NULL) {
+                    uncheckedRow(plane[i-1], plane[i], plane[i+1], start, end,
+                        omega);
+                    continue;
+                }
+                delta = relaxRow(plane[i-1], plane[i], plane[i+1], start, end,
+                    omega);
+                if(delta > sweepDelta[p/passes])
+                    sweepDelta[p/passes] = delta;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Performs the relaxation algorithm on a 2D array
+ * @param plane pointer to the 2D array
+ * @param sizeOfPlane number of rows and length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param kernel resolved kernel used to relax each row
+ * @param depth number of sweeps to apply in each pass down the plane
+ * @param checkInterval number of sweeps between convergence checks, or
+ *         CHECK_ADAPTIVE
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @return the number of iterations taken to perform the relaxation algorithm.
+ *          With more than one sweep per check only the last pass before the
+ *          check finds its changes, unless omega is being estimated, so this
+ *          is the first of those sweeps that converged
+ */
+unsigned long relaxPlane(double** plane, unsigned int sizeOfPlane,
+    double tolerance, Kernel kernel, int depth, int checkInterval,
+    OmegaEstimate* omega)
+{
+    unsigned long iterations = 0;
+    int i, p, colour, passes, sweeps, unchecked;
+    int n = (int)sizeOfPlane;
+    double delta, maxDelta;
+    RowKernel relaxRow = rowKernel(kernel, omega->over);
+    UncheckedRowKernel uncheckedRow = uncheckedRowKernel(kernel, omega->over);
+    CheckSchedule schedule = newCheckSchedule(checkInterval);
+    // Whole passes are done, so a check can come up to depth-1 sweeps late
+    double* sweepDelta = ( double* )malloc((size_t)(maxCheckInterval(&schedule)
+        + depth) * sizeof(double));
+
+    // Main loop
+    while(1) {
+        passes = (schedule.interval + depth - 1) / depth;
+        sweeps = passes * depth;
+        // Estimating omega needs every sweep's change, not just the last ones
+        unchecked = omega->estimating ? 0 : passes-1;
+
+        for(p=0; p<passes; p++) {
+            // Sweeps that are not checked can never be the one that converged
+            for(i=0; i<depth && p<unchecked; i++)
+                sweepDelta[p*depth+i] = HUGE_VAL;
+
+            // Temporal blocking, finding the change made by each sweep
+            if(depth > 1) {
+                relaxWavefront(plane, 1, n-1, n, 0, kernel, depth,
+                    omega->omega, p < unchecked ? NULL : &sweepDelta[p*depth]);
+                continue;
+            }
+
+            if(p < unchecked) {
+                for(colour=0; colour<(kernel == KERNEL_GS ? 1 : 2); colour++)
+                    for(i=1; i<n-1; i++)
+                        uncheckedRow(plane[i-1], plane[i], plane[i+1],
+                            kernel == KERNEL_GS ? 1 : colourStart(i, colour),
+                            n-1, omega->omega);
+                continue;
+            }
+
+            maxDelta = 0;
+            if(kernel == KERNEL_GS) {
+                for(i=1; i<n-1; i++) {
+                    delta = relaxRow(plane[i-1], plane[i], plane[i+1], 1, n-1,
+                        omega->omega);
+                    maxDelta = delta > maxDelta ? delta : maxDelta;
+                }
+            } else {
+                // Relax all of the red cells, then all of the black cells
+                for(colour=0; colour<2; colour++) {
+                    for(i=1; i<n-1; i++) {
+                        delta = relaxRow(plane[i-1], plane[i], plane[i+1],
+                            colourStart(i, colour), n-1, omega->omega);
+                        maxDelta = delta > maxDelta ? delta : maxDelta;
+                    }
+                }
+            }
+            sweepDelta[p] = maxDelta;
+        }
+
+        for(i=0; i<sweeps; i++) {
+            // Increment iteration counter
+            iterations++;
+            // If no cell changed by more than the tolerance, it is finished
+            if(!(tolerance < sweepDelta[i])) {
+                free(sweepDelta);
+                return iterations;
+            }
+            updateOmega(omega, sweepDelta[i]);
+        }
+        nextCheck(&schedule, sweepDelta[sweeps-1], sweeps, tolerance);
+    }
+}
+
+/**
+ * @brief Performs the relaxation algorithm in mixed precision. The plane is
+ *         relaxed as floats, which halves the memory traffic of each sweep,
+ *         until it converges or the changes stop shrinking. The result is
+ *         then relaxed as doubles until it converges
+ * @param plane pointer to the 2D array
+ * @param sizeOfPlane number of rows and length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param kernel resolved kernel used to relax each row
+ * @param checkInterval number of sweeps between convergence checks once it
+ *         is relaxed as doubles, or CHECK_ADAPTIVE
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @return the number of iterations taken, as floats and doubles together
+ */
+unsigned long mixedRelaxPlane(double** plane, unsigned int sizeOfPlane,
+    double tolerance, Kernel kernel, int checkInterval, OmegaEstimate* omega)
+{
+    unsigned long iterations = 0;
+    int i, colour;
+    int n = (int)sizeOfPlane;
+    int sinceSmallest = 0;
+    float delta, maxDelta, smallest = FLT_MAX, stall = 0;
+    FloatRowKernel relaxRow = floatRowKernel(kernel, omega->over);
+    float** floats = newFloatPlane(sizeOfPlane);
+
+    for(i=0; i<n; i++) {
+        for(int j=0; j<n; j++) {
+            floats[i][j] = (float)plane[i][j];
+            stall = fabsf(floats[i][j]) > stall ? fabsf(floats[i][j]) : stall;
+        }
+    }
+    // The largest cell is on an edge, so it sets the rounding of every cell
+    stall *= MIXED_STALL * FLT_EPSILON;
+
+    do {
+        maxDelta = 0;
+        iterations++;
+
+        if(kernel == KERNEL_GS) {
+            for(i=1; i<n-1; i++) {
+                delta = relaxRow(floats[i-1], floats[i], floats[i+1], 1, n-1,
+                    (float)omega->omega);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
+            }
+        } else {
+            for(colour=0; colour<2; colour++) {
+                for(i=1; i<n-1; i++) {
+                    delta = relaxRow(floats[i-1], floats[i], floats[i+1],
+                        colourStart(i, colour), n-1, (float)omega->omega);
+                    maxDelta = delta > maxDelta ? delta : maxDelta;
+                }
+            }
+        }
+        updateOmega(omega, maxDelta);
+
+        if(maxDelta < smallest) {
+            smallest = maxDelta;
+            sinceSmallest = 0;
+        } else {
+            sinceSmallest++;
+        }
+    } while(tolerance < maxDelta && stall < maxDelta &&
+        sinceSmallest < MIXED_PATIENCE);
+
+    for(i=1; i<n-1; i++)
+        for(int j=1; j<n-1; j++)
+            plane[i][j] = floats[i][j];
+    free(floats[0]);
+    free(floats);
+
+    return iterations + relaxPlane(plane, sizeOfPlane, tolerance, kernel, 1,
+        checkInterval, omega);
+}
+
+/**
+ * @brief Performs Jacobi iteration on a 2D array. Each iteration is written
+ *         into a second array, then the two arrays are swapped
+ * @param plane pointer to the 2D array, which holds the result at the end
+ * @param next second 2D array, with the same edges as plane
+ * @param sizeOfPlane number of rows and length of each row in the array
+ * @param tolerance the tolerance to perform the iteration to
+ * @param kernel resolved kernel, whose instruction set is used
+ * @return the number of iterations taken
+ */
+unsigned long jacobiPlane(double** plane, double** next,
+    unsigned int sizeOfPlane, double tolerance, Kernel kernel)
+{
+    unsigned long iterations = 0;
+    int n = (int)sizeOfPlane;
+    double delta, maxDelta;
+    double** current = plane;
+    double** swap;
+    JacobiRowKernel jacobiRowFn = jacobiKernel(kernel);
+    bool stream = shouldStream(2 * (size_t)n * (size_t)n * sizeof(double));
+
+    do {
+        maxDelta = 0;
+        iterations++;
+
+        for(int i=1; i<n-1; i++) {
+            delta = jacobiRowFn(current[i-1], current[i], current[i+1],
+                next[i], 1, n-1, stream);
+            maxDelta = delta > maxDelta ? delta : maxDelta;
+        }
+#ifdef HAVE_X86_SIMD
+        // Make sure the non-temporal stores are done before they are read
+        if(stream)
+            _mm_sfence();
+#endif
+
+        swap = current;
+        current = next;
+        next = swap;
+    } while(tolerance < maxDelta);
+
+    // The result ends up in whichever array was written last
+    if(current != plane)
+        for(int i=1; i<n-1; i++)
+            memcpy(&plane[i][1], &current[i][1],
+                (size_t)(n-2) * sizeof(double));
+
+    return iterations;
+}
+
+/**
+ * @brief Performs one Chebyshev step on every cell of a row. Each new value is
+ *         the Jacobi update over-relaxed against the value from the iteration
+ *         before last, which is read from and replaced in out
+ * @param above row above the one being relaxed, from the current iteration
+ * @param row row being relaxed, from the current iteration
+ * @param below row below the one being relaxed, from the current iteration
+ * @param out row from the iteration before last, to write the new row into
+ * @param start first column to relax
+ * @param end column after the last one to relax
+ * @param omega the Chebyshev weight for this iteration
+ * @param check true to find the largest change made to any cell
+ * @return the largest absolute change made to any cell, or 0 if not checked
+ */
+double chebyshevRow(const double* restrict above, const double* restrict row,
+    const double* restrict below, double* restrict out, int start, int end,
+    double omega, bool check)
+{
+    double delta, maxDelta = 0;
+
+    // Iterations that are not checked leave out the change entirely
+    if(!check) {
+        for(int j=start; j<end; j++)
+            out[j] += omega * ((above[j] + below[j] + row[j-1] + row[j+1])/4
+                - out[j]);
+        return 0;
+    }
+    for(int j=start; j<end; j++) {
+        out[j] += omega * ((above[j] + below[j] + row[j-1] + row[j+1])/4
+            - out[j]);
+        delta = fabs(out[j] - row[j]);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    return maxDelta;
+}
+
+/**
+ * @brief Performs Chebyshev accelerated Jacobi iteration on a 2D array. The
+ *         weights come from the spectral radius of Jacobi iteration on a grid
+ *         of this size, so nothing has to be measured while it runs. The
+ *         change is only found every checkInterval iterations
+ * @param plane pointer to the 2D array, which holds the result at the end
+ * @param next second 2D array, with the same edges and cells as plane
+ * @param sizeOfPlane number of rows and length of each row in the array
+ * @param tolerance the tolerance to perform the iteration to
+ * @param checkInterval number of iterations between convergence checks, or
+ *         CHECK_ADAPTIVE
+ * @return the number of iterations taken
+ */
+unsigned long chebyshevPlane(double** plane, double** next,
+    unsigned int sizeOfPlane, double tolerance, int checkInterval)
+{
+    unsigned long iterations = 0;
+    int n = (int)sizeOfPlane;
+    double rho = cos(M_PI/(double)(n-1));
+    double omega = 1;
+    double delta, maxDelta;
+    bool check;
+    int sinceCheck = 0;
+    CheckSchedule schedule = newCheckSchedule(checkInterval);
+    double** current = plane;
+    double** swap;
+
+    do {
+        maxDelta = 0;
+        iterations++;
+        check = ++sinceCheck == schedule.interval;
+
+        for(int i=1; i<n-1; i++) {
+            delta = chebyshevRow(current[i-1], current[i], current[i+1],
+                next[i], 1, n-1, omega, check);
+            maxDelta = delta > maxDelta ? delta : maxDelta;
+        }
+
+        swap = current;
+        current = next;
+        next = swap;
+
+        /* The first iteration is plain Jacobi, then the weights approach
+            their limit of the optimal over-relaxation factor */
+        omega = iterations == 1 ? 1/(1 - rho*rho/2)
+            : 1/(1 - rho*rho*omega/4);
+
+        if(check) {
+            nextCheck(&schedule, maxDelta, sinceCheck, tolerance);
+            sinceCheck = 0;
+        }
+    } while(!check || tolerance < maxDelta);
+
+    // The result ends up in whichever array was written last
+    if(current != plane)
+        for(int i=1; i<n-1; i++)
+            memcpy(&plane[i][1], &current[i][1],
+                (size_t)(n-2) * sizeof(double));
+
+    return iterations;
+}
+
+/**
+ * @brief Sets every cell of a 2D array to zero
+ * @param plane pointer to the 2D array
+ * @param numRows number of rows in the array
+ * @param n length of each row in the array
+ */
+void clearPlane(double** plane, int numRows, int n) {
+    for(int i=0; i<numRows; i++)
+        memset(plane[i], 0, (size_t)n * sizeof(double));
+}
+
+/**
+ * @brief Frees a 2D array made by newPlane
+ */
+void freePlane(double** plane) {
+    free(plane[0]);
+    free(plane);
+}
+
+/**
+ * @brief Gets the number of rows and columns of the next coarser grid
+ * @param n number of rows and columns of the finer grid
+ * @return number of rows and columns of the coarser grid
+ */
+int coarseSize(int n) {
+    return n/2 + 1;
+}
+
+/**
+ * @brief Gets the index on the finer grid of a row or column of the coarser
+ *         grid. Every other index is kept, apart from the last which is always
+ *         the edge of the plane, so grids of any size can be coarsened
+ * @param i index on the coarser grid
+ * @param coarseN number of rows and columns of the coarser grid
+ * @param fineN number of rows and columns of the finer grid
+ * @return index on the finer grid
+ */
+int fineIndex(int i, int coarseN, int fineN) {
+    return i == coarseN-1 ? fineN-1 : 2*i;
+}
+
+/**
+ * @brief Relaxes every other cell of a row for a level with a right hand side,
+ *         i.e. the cells of one colour for red-black ordering
+ * @param above row above the one being relaxed
+ * @param row row being relaxed
+ * @param below row below the one being relaxed
+ * @param rhs right hand side of the row, scaled by the grid spacing squared
+ * @param start first column of this colour to relax
+ * @param end column after the last one to relax
+ */
+void smoothRow(const double* restrict above, double* restrict row,
+    const double* restrict below, const double* restrict rhs, int start,
+    int end)
+{
+    for(int j=start; j<end; j+=2)
+        row[j] = (above[j] + below[j] + row[j-1] + row[j+1] + rhs[j])/4;
+}
+
+/**
+ * @brief Applies red-black sweeps to a level. The finest level has no right
+ *         hand side, so it is relaxed with the chosen kernel
+ * @param level the level to smooth
+ * @param relaxRow function used to relax rows of the finest level
+ * @param sweeps number of sweeps to apply
+ */
+void smoothLevel(MultigridLevel* level, RowKernel relaxRow, int sweeps) {
+    double** u = level->u;
+    int n = level->n;
+
+    for(int s=0; s<sweeps; s++) {
+        for(int colour=0; colour<2; colour++) {
+            for(int i=1; i<n-1; i++) {
+                if(level->rhs)
+                    smoothRow(u[i-1], u[i], u[i+1], level->rhs[i],
+                        colourStart(i, colour), n-1);
+                else
+                    relaxRow(u[i-1], u[i], u[i+1], colourStart(i, colour),
+                        n-1, 1);
+            }
+        }
+    }
+}
 
 /**
- * @brief Calculates the time in seconds between two timespec structs
- * @param start timespec struct with time less than end
- * @param end timespec struct with time greater than start
- * @return time difference between two struct
+ * @brief Calculates the residual of every cell in a level, scaled by the grid
+ *         spacing squared
+ * @param level the level to calculate the residual of
  */
-long double toSeconds(struct timespec start, struct timespec end) {
-    long long difSec = end.tv_sec - start.tv_sec;
-    long long difNSec = end.tv_nsec - start.tv_nsec;
-    long long totalNS = difSec*1000000000L + difNSec;
-    return (long double) totalNS / 1000000000.0;
+void residualLevel(MultigridLevel* level) {
+    double** u = level->u;
+    int n = level->n;
+
+    for(int i=1; i<n-1; i++) {
+        for(int j=1; j<n-1; j++) {
+            level->res[i][j] = (level->rhs ? level->rhs[i][j] : 0)
+                + u[i-1][j] + u[i+1][j] + u[i][j-1] + u[i][j+1] - 4*u[i][j];
+        }
+    }
 }
 
 /**
- * @brief Mallocs memory for a n*n 2D array
- * @param n the size of each side of the array
- * @return a pointer to an array of pointers to each row in the 2D array
+ * @brief Restricts the residual of a level to the right hand side of the next
+ *         coarser level with full weighting, and clears the coarser level's
+ *         correction. The right hand side is scaled by the coarser grid's
+ *         spacing squared, which is four times the finer grid's
+ * @param fine the finer level, with its residual calculated
+ * @param coarse the coarser level
  */
-double** newPlane(unsigned int n) {
-    double** plane = ( double** )malloc(n * sizeof(double*));
-    for (unsigned int i = 0; i < n; ++i)
-        plane[i] = ( double* )malloc(n * sizeof(double));
-    return plane;
+void restrictLevel(const MultigridLevel* fine, MultigridLevel* coarse) {
+    double** r = fine->res;
+    int i, j;
+
+    clearPlane(coarse->u, coarse->n, coarse->n);
+    for(int ci=1; ci<coarse->n-1; ci++) {
+        i = 2*ci;
+        for(int cj=1; cj<coarse->n-1; cj++) {
+            j = 2*cj;
+            coarse->rhs[ci][cj] = r[i][j]
+                + (r[i-1][j] + r[i+1][j] + r[i][j-1] + r[i][j+1])/2
+                + (r[i-1][j-1] + r[i-1][j+1] + r[i+1][j-1] + r[i+1][j+1])/4;
+        }
+    }
 }
 
 /**
- * @brief Populates the plane's walls with the values provided, and sets the
- *         centre parts to zero
+ * @brief Bilinearly interpolates a coarser level onto the cells of a finer
+ *         level, either adding it as a correction or replacing them
+ * @param coarse the coarser level
+ * @param fine the finer level
+ * @param add true to add to the finer level, false to overwrite it
+ */
+void prolongLevel(const MultigridLevel* coarse, MultigridLevel* fine,
+    bool add)
+{
+    double** c = coarse->u;
+    double val;
+    int i0, i1, j0, j1;
+
+    for(int i=1; i<fine->n-1; i++) {
+        // Even rows sit on a coarse row, odd rows between two of them
+        i0 = i/2;
+        i1 = (i+1)/2;
+        for(int j=1; j<fine->n-1; j++) {
+            j0 = j/2;
+            j1 = (j+1)/2;
+            val = (c[i0][j0] + c[i0][j1] + c[i1][j0] + c[i1][j1])/4;
+            fine->u[i][j] = add ? fine->u[i][j] + val : val;
+        }
+    }
+}
+
+/**
+ * @brief Copies the edges of a finer level onto the edges of the next coarser
+ *         level
+ * @param fine the finer level
+ * @param coarse the coarser level
+ */
+void injectEdges(const MultigridLevel* fine, MultigridLevel* coarse) {
+    int nc = coarse->n, nf = fine->n;
+    int fi, fj;
+
+    for(int i=0; i<nc; i++) {
+        fi = fineIndex(i, nc, nf);
+        for(int j=0; j<nc; j+=(i == 0 || i == nc-1) ? 1 : nc-1) {
+            fj = fineIndex(j, nc, nf);
+            coarse->u[i][j] = fine->u[fi][fj];
+        }
+    }
+}
+
+/**
+ * @brief Performs a V-cycle from a level down to the coarsest level and back
+ * @param levels the multigrid hierarchy
+ * @param l the level to start from
+ * @param numLevels number of levels in the hierarchy
+ * @param relaxRow function used to relax rows of the finest level
+ */
+void vCycle(MultigridLevel* levels, int l, int numLevels, RowKernel relaxRow)
+{
+    if(l == numLevels-1) {
+        smoothLevel(&levels[l], relaxRow, MG_COARSE_SWEEPS);
+        return;
+    }
+    smoothLevel(&levels[l], relaxRow, MG_SMOOTH);
+    residualLevel(&levels[l]);
+    restrictLevel(&levels[l], &levels[l+1]);
+    vCycle(levels, l+1, numLevels, relaxRow);
+    prolongLevel(&levels[l+1], &levels[l], true);
+    smoothLevel(&levels[l], relaxRow, MG_SMOOTH);
+}
+
+/**
+ * @brief Performs a full multigrid cycle. The plane is solved on the coarsest
+ *         level first, then each solution is interpolated onto the next finer
+ *         level as its starting point and improved with a V-cycle
+ * @param levels the multigrid hierarchy
+ * @param numLevels number of levels in the hierarchy
+ * @param relaxRow function used to relax rows of the finest level
+ */
+void fullMultigrid(MultigridLevel* levels, int numLevels, RowKernel relaxRow)
+{
+    int l;
+
+    // Coarser levels solve the plane itself, with their own copy of the edges
+    for(l=1; l<numLevels; l++) {
+        clearPlane(levels[l].u, levels[l].n, levels[l].n);
+        clearPlane(levels[l].rhs, levels[l].n, levels[l].n);
+        injectEdges(&levels[l-1], &levels[l]);
+    }
+    smoothLevel(&levels[numLevels-1], relaxRow, MG_COARSE_SWEEPS);
+
+    for(l=numLevels-2; l>=0; l--) {
+        if(levels[l].rhs)
+            clearPlane(levels[l].rhs, levels[l].n, levels[l].n);
+        prolongLevel(&levels[l+1], &levels[l], false);
+        vCycle(levels, l, numLevels, relaxRow);
+    }
+}
+
+/**
+ * @brief Solves the plane with multigrid. A full multigrid cycle is done
+ *         first, followed by V-cycles until the largest change made to any
+ *         cell by a cycle is within the tolerance
  * @param plane pointer to the 2D array
- * @param sizeOfPlane number of rows and length of each row
- * @param top value to put in top edge of 2D array
- * @param bottom value to put in bottom edge of 2D array
- * @param farLeft value to put in left edge of 2D array
- * @param farRight value to put in right edge of 2D array
+ * @param sizeOfPlane number of rows and length of each row in the array
+ * @param tolerance the tolerance to solve the plane to
+ * @param kernel resolved red-black kernel used to smooth the finest level
+ * @return the number of cycles taken
  */
-void populatePlane(double** plane, unsigned int sizeOfPlane, double top,
-    double bottom, double farLeft, double farRight)
-{   
-    // Fill 2D array with correct values
-    for(unsigned int j=0; j<sizeOfPlane; j++) {
-        for(unsigned int i=0; i<sizeOfPlane; i++) {
-            if(i == 0) {
-                // Left
-                plane[i][j] = farLeft;
-            } else if(j == 0) {
-                // Top
-                plane[i][j] = top;
-            } else if(i == sizeOfPlane-1) {
-                // Right
-                plane[i][j] = farRight;
-            } else if(j == sizeOfPlane-1) {
-                // Bottom
-                plane[i][j] = bottom;
-            } else {
-                // Centre 
-                plane[i][j] = 0;
+unsigned long multigridPlane(double** plane, unsigned int sizeOfPlane,
+    double tolerance, Kernel kernel)
+{
+    unsigned long iterations = 0;
+    RowKernel relaxRow = rowKernel(kernel, false);
+    int n = (int)sizeOfPlane;
+    int numLevels = 1;
+    double delta, maxDelta;
+    MultigridLevel* levels;
+    double** prev = newPlane(sizeOfPlane);
+
+    // Coarsen until the grid has at most 2x2 cells inside its edges
+    for(int m=n; m>4; m=coarseSize(m))
+        numLevels++;
+    levels = ( MultigridLevel* )malloc((size_t)numLevels
+        * sizeof(MultigridLevel));
+
+    levels[0].n = n;
+    levels[0].u = plane;
+    levels[0].rhs = NULL;
+    levels[0].res = newPlane(sizeOfPlane);
+    clearPlane(levels[0].res, n, n);
+    for(int l=1; l<numLevels; l++) {
+        levels[l].n = coarseSize(levels[l-1].n);
+        levels[l].u = newPlane((unsigned int)levels[l].n);
+        levels[l].rhs = newPlane((unsigned int)levels[l].n);
+        levels[l].res = newPlane((unsigned int)levels[l].n);
+        clearPlane(levels[l].res, levels[l].n, levels[l].n);
+    }
+
+    do {
+        for(int i=1; i<n-1; i++)
+            memcpy(&prev[i][1], &plane[i][1], (size_t)(n-2) * sizeof(double));
+
+        if(iterations == 0 && numLevels > 1)
+            fullMultigrid(levels, numLevels, relaxRow);
+        else
+            vCycle(levels, 0, numLevels, relaxRow);
+        iterations++;
+
+        maxDelta = 0;
+        for(int i=1; i<n-1; i++) {
+            for(int j=1; j<n-1; j++) {
+                delta = fabs(plane[i][j]-prev[i][j]);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
             }
         }
+    } while(tolerance < maxDelta);
+
+    freePlane(levels[0].res);
+    for(int l=1; l<numLevels; l++) {
+        freePlane(levels[l].u);
+        freePlane(levels[l].rhs);
+        freePlane(levels[l].res);
     }
+    free(levels);
+    freePlane(prev);
+    return iterations;
 }
 
 /**
- * @brief Prints out a 2D array to stdout
+ * @brief Applies the 5-point Laplacian to the cells inside a 2D array whose
+ *         edges are zero. This is the matrix of the linear system that
+ *         relaxation solves, applied without forming it
+ * @param in pointer to the 2D array to apply the Laplacian to
+ * @param out pointer to the 2D array to write the result into
+ * @param sizeOfPlane number of rows and length of each row in the arrays
+ * @return the dot product of in and out
+ */
+double applyLaplacian(double** in, double** out, int sizeOfPlane) {
+    double dot = 0;
+
+    for(int i=1; i<sizeOfPlane-1; i++) {
+        for(int j=1; j<sizeOfPlane-1; j++) {
+            out[i][j] = 4*in[i][j] - in[i-1][j] - in[i+1][j] - in[i][j-1]
+                - in[i][j+1];
+            dot += in[i][j] * out[i][j];
+        }
+    }
+    return dot;
+}
+
+/**
+ * @brief Calculates the residual of the plane, i.e. how far each cell is from
+ *         the average of its neighbours times four
+ * @param plane pointer to the 2D array
+ * @param res pointer to the 2D array to write the residual into
+ * @param sizeOfPlane number of rows and length of each row in the arrays
+ * @return the dot product of the residual with itself
+ */
+double residualPlane(double** plane, double** res, int sizeOfPlane) {
+    double dot = 0;
+
+    for(int i=1; i<sizeOfPlane-1; i++) {
+        for(int j=1; j<sizeOfPlane-1; j++) {
+            res[i][j] = plane[i-1][j] + plane[i+1][j] + plane[i][j-1]
+                + plane[i][j+1] - 4*plane[i][j];
+            dot += res[i][j] * res[i][j];
+        }
+    }
+    return dot;
+}
+
+/**
+ * @brief Solves the plane with the conjugate gradient method, stopping once
+ *         the largest change made to any cell by an iteration is within the
+ *         tolerance
  * @param plane pointer to the 2D array
  * @param sizeOfPlane number of rows and length of each row in the array
+ * @param tolerance the tolerance to solve the plane to
+ * @return the number of iterations taken
  */
-void printPlane(double** plane, unsigned int sizeOfPlane) {
-    for(unsigned int x=0; x<sizeOfPlane; x++) {
-        for(unsigned int y=0; y<sizeOfPlane; y++) {
-            printf("%f, ", plane[x][y]);
+unsigned long conjugateGradientPlane(double** plane, unsigned int sizeOfPlane,
+    double tolerance)
+{
+    unsigned long iterations = 0;
+    int n = (int)sizeOfPlane;
+    double alpha, beta, gamma, nextGamma, change, maxDelta;
+    double** res = newPlane(sizeOfPlane);
+    double** dir = newPlane(sizeOfPlane);
+    double** prod = newPlane(sizeOfPlane);
+
+    // The search direction's edges must stay zero for applyLaplacian
+    clearPlane(res, n, n);
+    clearPlane(dir, n, n);
+    clearPlane(prod, n, n);
+
+    gamma = residualPlane(plane, res, n);
+    for(int i=1; i<n-1; i++)
+        memcpy(&dir[i][1], &res[i][1], (size_t)(n-2) * sizeof(double));
+
+    // A residual of zero means the plane is already solved
+    while(gamma > 0) {
+        alpha = gamma/applyLaplacian(dir, prod, n);
+
+        maxDelta = 0;
+        nextGamma = 0;
+        for(int i=1; i<n-1; i++) {
+            for(int j=1; j<n-1; j++) {
+                change = alpha * dir[i][j];
+                plane[i][j] += change;
+                res[i][j] -= alpha * prod[i][j];
+                nextGamma += res[i][j] * res[i][j];
+                change = fabs(change);
+                maxDelta = change > maxDelta ? change : maxDelta;
+            }
         }
-        printf("\n");
+        iterations++;
+        if(!(tolerance < maxDelta))
+            break;
+
+        beta = nextGamma/gamma;
+        gamma = nextGamma;
+        for(int i=1; i<n-1; i++)
+            for(int j=1; j<n-1; j++)
+                dir[i][j] = res[i][j] + beta * dir[i][j];
     }
-    printf("\n");
+
+    freePlane(res);
+    freePlane(dir);
+    freePlane(prod);
+    return iterations;
 }
 
 /**
- * @brief Performs the relaxation algorithm on a 2D array
+ * @brief Solves the plane with the pipelined conjugate gradient method. It
+ *         takes the same steps as conjugate gradients, but rearranged so both
+ *         dot products of an iteration are found together, in the same pass
+ *         as the vector updates, and the next product with the Laplacian does
+ *         not depend on them. With more than one process this lets the
+ *         reduction run while the product is found
  * @param plane pointer to the 2D array
  * @param sizeOfPlane number of rows and length of each row in the array
- * @param tolerance the tolerance to perform the relaxation algorithm to
- * @return the number of iterations taken to perform the relaxation algorithm
+ * @param tolerance the tolerance to solve the plane to
+ * @return the number of iterations taken
  */
-unsigned long relaxPlane(double** plane, unsigned int sizeOfPlane,
+unsigned long pipelinedCGPlane(double** plane, unsigned int sizeOfPlane,
     double tolerance)
 {
     unsigned long iterations = 0;
-    unsigned int i,j;
-    double pVal;
-    bool endFlag;
+    int n = (int)sizeOfPlane;
+    double alpha = 0, beta = 0, gamma, lastGamma = 0, delta;
+    double change, maxDelta;
+    // The residual, its product with the Laplacian, and their recurrences
+    double** res = newPlane(sizeOfPlane);
+    double** w = newPlane(sizeOfPlane);
+    double** aw = newPlane(sizeOfPlane);
+    double** dir = newPlane(sizeOfPlane);
+    double** s = newPlane(sizeOfPlane);
+    double** z = newPlane(sizeOfPlane);
 
-    // Main loop
-    while (1) {
-        // Reset the flag
-        endFlag = true;
-        // Increment iteration counter
+    clearPlane(res, n, n);
+    clearPlane(w, n, n);
+    clearPlane(aw, n, n);
+    clearPlane(dir, n, n);
+    clearPlane(s, n, n);
+    clearPlane(z, n, n);
+
+    gamma = residualPlane(plane, res, n);
+    delta = applyLaplacian(res, w, n);
+
+    // A residual of zero means the plane is already solved
+    while(gamma > 0) {
+        applyLaplacian(w, aw, n);
+
+        if(iterations > 0) {
+            beta = gamma/lastGamma;
+            alpha = gamma/(delta - beta*gamma/alpha);
+        } else {
+            alpha = gamma/delta;
+        }
+        lastGamma = gamma;
+
+        maxDelta = 0;
+        gamma = 0;
+        delta = 0;
+        for(int i=1; i<n-1; i++) {
+            for(int j=1; j<n-1; j++) {
+                z[i][j] = aw[i][j] + beta * z[i][j];
+                s[i][j] = w[i][j] + beta * s[i][j];
+                dir[i][j] = res[i][j] + beta * dir[i][j];
+                change = alpha * dir[i][j];
+                plane[i][j] += change;
+                res[i][j] -= alpha * s[i][j];
+                w[i][j] -= alpha * z[i][j];
+                gamma += res[i][j] * res[i][j];
+                delta += w[i][j] * res[i][j];
+                change = fabs(change);
+                maxDelta = change > maxDelta ? change : maxDelta;
+            }
+        }
         iterations++;
+        if(!(tolerance < maxDelta))
+            break;
+    }
 
-        for(i=1; i<sizeOfPlane-1; i++) {
-            for(j=1; j<sizeOfPlane-1; j++) {
-                // Temporarily store previous value
-                pVal = plane[i][j];
-                // Calulate new value
-                plane[i][j] = (plane[i-1][j] + plane[i+1][j] + plane[i][j-1]
-                    + plane[i][j+1])/4;
-                /* If the endflag is still true and the absolute differnece
-                 * between the old and new value is greater than the
-                 * tolerance, set the flag to false */
-                if(endFlag && tolerance < fabs(plane[i][j]-pVal)) {
-                    endFlag = false;
-                }
+    freePlane(res);
+    freePlane(w);
+    freePlane(aw);
+    freePlane(dir);
+    freePlane(s);
+    freePlane(z);
+    return iterations;
+}
+
+/**
+ * @brief Performs an in place radix-2 FFT
+ * @param plan the plan whose twiddle factors are used
+ * @param data the values to transform, of the plan's power of two size
+ * @param inverse true for the inverse transform, which is not scaled
+ */
+void fft(const DstPlan* plan, double complex* data, bool inverse) {
+    int size = plan->size;
+    int bit, j = 0;
+    double complex u, v, w;
+
+    // Put the values in bit reversed order
+    for(int i=1; i<size; i++) {
+        for(bit=size>>1; j & bit; bit>>=1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j) {
+            u = data[i];
+            data[i] = data[j];
+            data[j] = u;
+        }
+    }
+
+    for(int len=2; len<=size; len<<=1) {
+        for(int i=0; i<size; i+=len) {
+            for(int k=0; k<len/2; k++) {
+                w = plan->twiddle[k * (size/len)];
+                v = data[i+k+len/2] * (inverse ? conj(w) : w);
+                u = data[i+k];
+                data[i+k] = u + v;
+                data[i+k+len/2] = u - v;
             }
         }
+    }
+}
 
-        // It the flag was not set to false this iteration, then it is finished
-        if(endFlag)
-            break;
+/**
+ * @brief Makes a plan for discrete sine transforms of rows of a given length
+ * @param length number of values in each row
+ * @return the plan
+ */
+DstPlan newDstPlan(int length) {
+    DstPlan plan;
+    // Length of the odd extension of a row
+    int m = 2*(length+1);
+    long long phase;
+
+    plan.length = length;
+    plan.size = 1;
+    while(plan.size < 2*m-1)
+        plan.size <<= 1;
+
+    plan.chirp = ( double complex* )malloc((size_t)m * sizeof(double complex));
+    plan.kernel = ( double complex* )calloc((size_t)plan.size,
+        sizeof(double complex));
+    plan.twiddle = ( double complex* )malloc((size_t)(plan.size/2)
+        * sizeof(double complex));
+    plan.work = ( double complex* )malloc((size_t)plan.size
+        * sizeof(double complex));
+
+    for(int k=0; k<plan.size/2; k++)
+        plan.twiddle[k] = cexp(-2*M_PI*I*k/plan.size);
+    // k^2 is taken modulo 2m so large k keep their precision
+    for(int k=0; k<m; k++) {
+        phase = (long long)k*k % (2*m);
+        plan.chirp[k] = cexp(-M_PI*I*(double)phase/m);
+    }
+    plan.kernel[0] = conj(plan.chirp[0]);
+    for(int k=1; k<m; k++) {
+        plan.kernel[k] = conj(plan.chirp[k]);
+        plan.kernel[plan.size-k] = conj(plan.chirp[k]);
+    }
+    fft(&plan, plan.kernel, false);
+
+    return plan;
+}
+
+/**
+ * @brief Frees the memory held by a plan
+ * @param plan the plan
+ */
+void freeDstPlan(DstPlan* plan) {
+    free(plan->chirp);
+    free(plan->kernel);
+    free(plan->twiddle);
+    free(plan->work);
+}
+
+/**
+ * @brief Replaces two rows with their type I discrete sine transforms, i.e.
+ *         x[k] = sum over j of x[j]*sin(pi*(j+1)*(k+1)/(length+1)). The rows
+ *         are real, so the second is transformed as the imaginary part of the
+ *         first for free
+ * @param plan plan for rows of this length
+ * @param x the first row to transform
+ * @param y the second row to transform, or NULL for only one row
+ */
+void dstRows(DstPlan* plan, double* x, double* y) {
+    int n = plan->length;
+    int m = 2*(n+1);
+    double complex* work = plan->work;
+    double complex val;
+
+    // The odd extension of the rows, multiplied by the chirp
+    work[0] = 0;
+    work[n+1] = 0;
+    for(int j=1; j<=n; j++) {
+        val = y ? CMPLX(x[j-1], y[j-1]) : x[j-1];
+        work[j] = val * plan->chirp[j];
+        work[m-j] = -val * plan->chirp[m-j];
+    }
+    memset(&work[m], 0, (size_t)(plan->size-m) * sizeof(double complex));
+
+    fft(plan, work, false);
+    for(int k=0; k<plan->size; k++)
+        work[k] *= plan->kernel[k];
+    fft(plan, work, true);
+
+    // The FFT of an odd extension is -2i times the sine transform
+    for(int k=1; k<=n; k++) {
+        val = plan->chirp[k] * work[k] / (2.0 * plan->size);
+        x[k-1] = -cimag(val);
+        if(y)
+            y[k-1] = creal(val);
+    }
+}
+
+/**
+ * @brief Gets the eigenvalues of the 1D second difference matrix of a given
+ *         size, which the sine transform diagonalises
+ * @param length size of the matrix
+ * @return array of the eigenvalues
+ */
+double* laplacianEigenvalues(int length) {
+    double* eigen = ( double* )malloc((size_t)length * sizeof(double));
+
+    for(int k=0; k<length; k++)
+        eigen[k] = 2 - 2*cos(M_PI*(k+1)/(length+1));
+    return eigen;
+}
+
+/**
+ * @brief Solves the plane directly with discrete sine transforms. The sine
+ *         transform along each axis diagonalises the 5-point Laplacian, so
+ *         the transformed edges are divided by its eigenvalues and then
+ *         transformed back. This gives the exact solution of the system that
+ *         relaxation converges to, without iterating
+ * @param plane pointer to the 2D array
+ * @param sizeOfPlane number of rows and length of each row in the array
+ * @return the number of iterations taken, which is always 1
+ */
+unsigned long dstPlane(double** plane, unsigned int sizeOfPlane) {
+    int n = (int)sizeOfPlane;
+    int inner = n-2;
+    double scale = 4.0/((double)(inner+1)*(inner+1));
+    double* rhs = ( double* )malloc((size_t)inner*(size_t)inner
+        * sizeof(double));
+    double* trans = ( double* )malloc((size_t)inner*(size_t)inner
+        * sizeof(double));
+    double* eigen = laplacianEigenvalues(inner);
+    DstPlan plan = newDstPlan(inner);
+
+    // Each cell next to an edge takes the edge's value as its right hand side
+    for(int i=0; i<inner; i++) {
+        for(int j=0; j<inner; j++) {
+            rhs[i*inner+j] = (i == 0 ? plane[0][j+1] : 0)
+                + (i == inner-1 ? plane[n-1][j+1] : 0)
+                + (j == 0 ? plane[i+1][0] : 0)
+                + (j == inner-1 ? plane[i+1][n-1] : 0);
+        }
+    }
+    for(int i=0; i<inner; i+=2)
+        dstRows(&plan, &rhs[i*inner], i+1 < inner ? &rhs[(i+1)*inner] : NULL);
+
+    // Transform the columns as rows of the transpose, then divide
+    for(int i=0; i<inner; i++)
+        for(int j=0; j<inner; j++)
+            trans[j*inner+i] = rhs[i*inner+j];
+    for(int i=0; i<inner; i+=2)
+        dstRows(&plan, &trans[i*inner],
+            i+1 < inner ? &trans[(i+1)*inner] : NULL);
+    for(int i=0; i<inner; i++)
+        for(int j=0; j<inner; j++)
+            trans[i*inner+j] /= eigen[i] + eigen[j];
+    for(int i=0; i<inner; i+=2)
+        dstRows(&plan, &trans[i*inner],
+            i+1 < inner ? &trans[(i+1)*inner] : NULL);
+
+    // The sine transform is its own inverse, apart from the scale
+    for(int i=0; i<inner; i++)
+        for(int j=0; j<inner; j++)
+            rhs[j*inner+i] = trans[i*inner+j];
+    for(int i=0; i<inner; i+=2)
+        dstRows(&plan, &rhs[i*inner], i+1 < inner ? &rhs[(i+1)*inner] : NULL);
+    for(int i=0; i<inner; i++)
+        for(int j=0; j<inner; j++)
+            plane[i+1][j+1] = rhs[i*inner+j] * scale;
+
+    freeDstPlan(&plan);
+    free(eigen);
+    free(trans);
+    free(rhs);
+    return 1;
+}
+
+/**
+ * @brief Everything a thread needs to relax its rows of the plane
+ */
+typedef struct {
+    double** plane;
+    int sizeOfPlane;
+    int rowStart;
+    int rowEnd;
+    int id;
+    int numThreads;
+    double tolerance;
+    Kernel kernel;
+    ThreadDelta* deltas;
+    pthread_barrier_t* barrier;
+    OmegaEstimate omega;
+    unsigned long iterations;
+} Worker;
+
+/**
+ * @brief Relaxes a thread's rows of the plane with red-black ordering until
+ *         every thread's rows have converged
+ * @param arg pointer to the thread's Worker
+ * @return NULL
+ */
+void* relaxWorker(void* arg) {
+    Worker* worker = ( Worker* )arg;
+    RowKernel relaxRow = rowKernel(worker->kernel, worker->omega.over);
+    ThreadDelta* deltas;
+    int i, colour;
+    double delta, maxDelta;
+
+    do {
+        /* Alternate between two sets of flags, so a thread that has already
+            started the next iteration cannot overwrite a flag that a slower
+            thread has not read yet */
+        deltas = &worker->deltas[(worker->iterations % 2) * 
+            (unsigned long)worker->numThreads];
+        worker->iterations++;
+        maxDelta = 0;
+
+        // Relax all of the red cells, then all of the black cells
+        for(colour=0; colour<2; colour++) {
+            for(i=worker->rowStart; i<worker->rowEnd; i++) {
+                delta = relaxRow(worker->plane[i-1], worker->plane[i],
+                    worker->plane[i+1], colourStart(i, colour),
+                    worker->sizeOfPlane-1, worker->omega.omega);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
+            }
+            if(colour == 1)
+                deltas[worker->id].maxDelta = maxDelta;
+            // Wait until every thread has finished this colour
+            pthread_barrier_wait(worker->barrier);
+        }
+
+        /* Every thread comes to the same decision, and the same estimate of
+            omega, from the same flags */
+        maxDelta = 0;
+        for(i=0; i<worker->numThreads; i++)
+            if(deltas[i].maxDelta > maxDelta)
+                maxDelta = deltas[i].maxDelta;
+        updateOmega(&worker->omega, maxDelta);
+    } while(worker->tolerance < maxDelta);
+
+    return NULL;
+}
+
+/**
+ * @brief Performs the relaxation algorithm on a 2D array using several
+ *         threads, each relaxing a block of rows with red-black ordering
+ * @param plane pointer to the 2D array
+ * @param sizeOfPlane number of rows and length of each row in the array
+ * @param tolerance the tolerance to perform the relaxation algorithm to
+ * @param kernel resolved red-black kernel used to relax each row
+ * @param numThreads number of threads to use, including this one
+ * @param omega over-relaxation factor, updated as it is estimated
+ * @return the number of iterations taken to perform the relaxation algorithm
+ */
+unsigned long relaxPlaneThreaded(double** plane, unsigned int sizeOfPlane,
+    double tolerance, Kernel kernel, int numThreads, OmegaEstimate* omega)
+{
+    int sizeOfInner = (int)sizeOfPlane-2;
+    int rowsPerThreadE = sizeOfInner/numThreads;
+    int remainingRows = sizeOfInner - numThreads * rowsPerThreadE;
+    pthread_t* threads = ( pthread_t* )malloc((size_t)numThreads
+        * sizeof(pthread_t));
+    Worker* workers = ( Worker* )malloc((size_t)numThreads * sizeof(Worker));
+    ThreadDelta* deltas = ( ThreadDelta* )aligned_alloc(sizeof(ThreadDelta),
+        2 * (size_t)numThreads * sizeof(ThreadDelta));
+    pthread_barrier_t barrier;
+    unsigned long iterations;
+    int rowStart = 1;
+
+    pthread_barrier_init(&barrier, NULL, (unsigned int)numThreads);
+
+    // Split the rows as evenly as possible, the first threads get any extra
+    for(int t=0; t<numThreads; t++) {
+        workers[t].plane = plane;
+        workers[t].sizeOfPlane = (int)sizeOfPlane;
+        workers[t].rowStart = rowStart;
+        rowStart += rowsPerThreadE + (t < remainingRows ? 1 : 0);
+        workers[t].rowEnd = rowStart;
+        workers[t].id = t;
+        workers[t].numThreads = numThreads;
+        workers[t].tolerance = tolerance;
+        workers[t].kernel = kernel;
+        workers[t].deltas = deltas;
+        workers[t].barrier = &barrier;
+        workers[t].omega = *omega;
+        workers[t].iterations = 0;
     }
 
+    // This thread relaxes the first block of rows itself
+    for(int t=1; t<numThreads; t++)
+        pthread_create(&threads[t], NULL, relaxWorker, &workers[t]);
+    relaxWorker(&workers[0]);
+    for(int t=1; t<numThreads; t++)
+        pthread_join(threads[t], NULL);
+
+    iterations = workers[0].iterations;
+    *omega = workers[0].omega;
+    pthread_barrier_destroy(&barrier);
+    free(deltas);
+    free(workers);
+    free(threads);
     return iterations;
 }
 
@@ -137,18 +3108,39 @@ int main(int argc, char **argv)
     double top = 1;
     double bottom = 3;
     bool debug = false;
+    bool mixed = false;
+    int kernel = KERNEL_GS;
+    int depth = 1;
+    int checkInterval = 1;
+    int numThreads = 1;
+    int method = METHOD_RELAX;
+    int omegaMode = OMEGA_GRID;
+    double omega = 1;
+    OmegaEstimate omegaEstimate;
 
     // For timing algorithm
     struct timespec start, end;
 
     double** plane;
+    double** next = NULL;
 
     unsigned long iterations;
 
     int opt;
+    const struct option longOptions[] = {
+        {"kernel", required_argument, NULL, 'k'},
+        {"block", required_argument, NULL, 'b'},
+        {"check", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"method", required_argument, NULL, 'm'},
+        {"omega", required_argument, NULL, 'w'},
+        {"mixed", no_argument, NULL, 'f'},
+        {NULL, 0, NULL, 0}
+    };
 
     // Parse any command line flags
-    while ((opt = getopt (argc, argv, "u:d:l:r:s:p:h:x")) != -1)
+    while ((opt = getopt_long (argc, argv, "u:d:l:r:s:p:k:b:c:t:m:w:h:xf",
+        longOptions, NULL)) != -1)
         switch (opt) {
             case 'u':
                 top = atof(optarg);
@@ -168,6 +3160,37 @@ int main(int argc, char **argv)
             case 'p':
                 tolerance = atof(optarg);
                 break;
+            case 'k':
+                kernel = parseKernel(optarg);
+                if(kernel < 0) {
+                    fprintf (stderr, "Unknown kernel `%s'.\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                depth = atoi(optarg);
+                break;
+            case 'c':
+                checkInterval = parseCheck(optarg);
+                break;
+            case 't':
+                numThreads = atoi(optarg);
+                break;
+            case 'm':
+                method = parseMethod(optarg);
+                if(method < 0) {
+                    fprintf (stderr, "Unknown method `%s'.\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'w':
+                omegaMode = parseOmega(optarg, &omega);
+                if(omegaMode < 0) {
+                    fprintf (stderr, "Omega must be between 0 and 2, grid or "
+                        "estimate\n");
+                    return 1;
+                }
+                break;
             case 'h':
                 // TODO print help stuff
                 printf("TODO help info\n");
@@ -175,6 +3198,9 @@ int main(int argc, char **argv)
             case 'x':
                 debug = true;
                 break;
+            case 'f':
+                mixed = true;
+                break;
             default:
                 fprintf (stderr, "Unknown option `\\x%x'.\n", optopt);
                 return 1;
@@ -185,20 +3211,111 @@ int main(int argc, char **argv)
         fprintf (stderr, "The size of the plane must be greater than 2\n");
         return 1;
     }
+    // At least one sweep must be done between each convergence check
+    if(depth < 1) {
+        fprintf (stderr, "The number of sweeps per block must be at least 1\n");
+        return 1;
+    }
+    // Convergence must be checked at some point
+    if(checkInterval == 0) {
+        fprintf (stderr, "The number of iterations between checks must be at "
+            "least 1, or adaptive\n");
+        return 1;
+    }
+    // Must have at least one thread, or ends with exit code 1
+    if(numThreads < 1) {
+        fprintf (stderr, "The number of threads must be at least 1\n");
+        return 1;
+    }
+    // Temporal blocking is only done on a single thread
+    if(numThreads > 1 && depth > 1) {
+        fprintf (stderr, "More than one sweep per block needs a single "
+            "thread\n");
+        return 1;
+    }
+    // The threads check for convergence at every barrier anyway
+    if(numThreads > 1 && checkInterval != 1) {
+        fprintf (stderr, "Checking less often than every iteration needs a "
+            "single thread\n");
+        return 1;
+    }
+    // SOR and the multigrid smoother are only done with red-black ordering
+    if((method == METHOD_SOR || method == METHOD_MG) && kernel == KERNEL_GS)
+        kernel = KERNEL_RB;
+    // Only relax and sor can use more threads or more sweeps at a time
+    if(method != METHOD_RELAX && method != METHOD_SOR &&
+        (numThreads > 1 || depth > 1))
+    {
+        fprintf (stderr, "The %s method needs a single thread and one sweep "
+            "per block\n", methodName((Method)method));
+        return 1;
+    }
+    // Only single threaded relax and sor have float sweeps
+    if(mixed && ((method != METHOD_RELAX && method != METHOD_SOR) ||
+        numThreads > 1 || depth > 1))
+    {
+        fprintf (stderr, "Mixed precision needs the relax or sor method, a "
+            "single thread and one sweep per block\n");
+        return 1;
+    }
     // Tolerance must be greater than 0, or ends with exit code 1
     if(tolerance < 0) {
         fprintf (stderr, "The tolerance must be greater than 0\n");
         return 1;
     }
 
+    // Pick the kernel this CPU can run, or ends with exit code 1
+    if(resolveKernel((Kernel)kernel) < 0) {
+        fprintf (stderr, "The %s kernel is not supported on this CPU\n",
+            kernelName((Kernel)kernel));
+        return 1;
+    }
+    kernel = resolveKernel((Kernel)kernel);
+    // Gauss-Seidel order is not well defined across threads, so use red-black
+    if(numThreads > 1 && kernel == KERNEL_GS)
+        kernel = KERNEL_RB;
+
+    // Only the sor method over-relaxes
+    omegaEstimate = newOmegaEstimate(method == METHOD_SOR ?
+        (OmegaMode)omegaMode : OMEGA_FIXED, omega, (int)sizeOfPlane);
+
     // Create 2D array and populate values
     plane = newPlane(sizeOfPlane);
     populatePlane(plane, sizeOfPlane, left, right, top, bottom);
+    // Jacobi iteration needs a second array to write each iteration into
+    if(method == METHOD_JACOBI || method == METHOD_CHEBYSHEV) {
+        next = newPlane(sizeOfPlane);
+        populatePlane(next, sizeOfPlane, left, right, top, bottom);
+    }
 
     // Start timer
     clock_gettime(CLOCK_MONOTONIC, &start);
     // Perform relaxation algorithm
-    iterations = relaxPlane(plane, sizeOfPlane, tolerance);
+    if(method == METHOD_JACOBI) {
+        iterations = jacobiPlane(plane, next, sizeOfPlane, tolerance,
+            (Kernel)kernel);
+    } else if(method == METHOD_CHEBYSHEV) {
+        iterations = chebyshevPlane(plane, next, sizeOfPlane, tolerance,
+            checkInterval);
+    } else if(method == METHOD_MG) {
+        iterations = multigridPlane(plane, sizeOfPlane, tolerance,
+            (Kernel)kernel);
+    } else if(method == METHOD_DST) {
+        iterations = dstPlane(plane, sizeOfPlane);
+    } else if(method == METHOD_CG) {
+        iterations = conjugateGradientPlane(plane, sizeOfPlane, tolerance);
+    } else if(method == METHOD_PIPECG) {
+        iterations = pipelinedCGPlane(plane, sizeOfPlane, tolerance);
+    } else if(numThreads > 1) {
+        iterations = relaxPlaneThreaded(plane, sizeOfPlane, tolerance,
+            (Kernel)kernel, numThreads, &omegaEstimate);
+    } else if(mixed) {
+        iterations = mixedRelaxPlane(plane, sizeOfPlane, tolerance,
+            (Kernel)kernel, checkInterval, &omegaEstimate);
+    } else {
+        iterations = relaxPlane(plane, sizeOfPlane, tolerance, (Kernel)kernel,
+            depth, checkInterval, &omegaEstimate);
+    }
     // End timer
     clock_gettime(CLOCK_MONOTONIC, &end);
 
@@ -207,7 +3324,13 @@ int main(int argc, char **argv)
         printPlane(plane, sizeOfPlane);
 
     // Print out information about how the program ran
-    printf("Threads: 1\n");
+    printf("Threads: %d\n", numThreads);
+    printf("Method: %s\n", methodName((Method)method));
+    printf("Kernel: %s\n", kernelName((Kernel)kernel));
+    if(method == METHOD_SOR)
+        printf("Omega: %f\n", omegaEstimate.omega);
+    if(mixed)
+        printf("Precision: mixed\n");
     printf("Size of Pane: %d\n", sizeOfPlane);
     printf("Iterations: %lu\n", iterations);
     printf("Time: %Lfs\n", toSeconds(start, end));